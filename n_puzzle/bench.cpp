@@ -0,0 +1,421 @@
+#include "solver.h"
+
+#include <new>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+// Heap allocations made by the calling thread, read by the micro-benchmarks.
+thread_local long long allocationCount = 0;
+
+__attribute__((noinline)) void* operator new(size_t size) {
+    allocationCount++;
+
+    if (void* memory = malloc(size ? size : 1)) {
+        return memory;
+    }
+
+    throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void operator delete(void* memory) noexcept {
+    free(memory);
+}
+
+__attribute__((noinline)) void operator delete(void* memory, size_t) noexcept {
+    free(memory);
+}
+
+// Hardware counters of the calling thread through perf_event_open. Each is
+// opened on its own, so one the machine lacks (or perf_event_paranoid
+// forbids) reads as -1 without losing the others.
+class PerfCounters {
+private:
+    std::vector<int> fds;
+
+public:
+    static const int count = 5;
+
+    static const char* name(int counter) {
+        const char* names[count] = {"cycles", "instructions", "cache-misses", "branch-misses", "stalls"};
+        return names[counter];
+    }
+
+    // stalls counts the cycles the back end waited, on memory above all.
+    PerfCounters() {
+        const uint64_t configs[count] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                         PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES,
+                                         PERF_COUNT_HW_STALLED_CYCLES_BACKEND};
+
+        for (uint64_t config : configs) {
+            perf_event_attr attr = {};
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.size = sizeof(attr);
+            attr.config = config;
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+
+            fds.push_back(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+        }
+    }
+
+    ~PerfCounters() {
+        for (int fd : fds) {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+    }
+
+    void start() {
+        for (int fd : fds) {
+            if (fd >= 0) {
+                ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+    }
+
+    std::vector<long long> stop() {
+        std::vector<long long> values;
+
+        for (int fd : fds) {
+            long long value = -1;
+
+            if (fd >= 0) {
+                ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+
+                if (read(fd, &value, sizeof(value)) != sizeof(value)) {
+                    value = -1;
+                }
+            }
+
+            values.push_back(value);
+        }
+
+        return values;
+    }
+};
+
+volatile long long benchSink;
+
+// Runs round (one pass over a corpus of opsPerRound operations) until 200 ms
+// have passed and prints one line per primitive: ns, allocations and each
+// hardware counter per operation, "-" where a counter is unavailable.
+template <typename Round>
+void benchPrimitive(int side, const char* representation, const char* primitive, long long opsPerRound,
+                    PerfCounters& counters, Round round) {
+    long long ops = 0, sink = 0;
+    long long allocations = allocationCount;
+    auto begin = std::chrono::steady_clock::now();
+    double seconds = 0;
+
+    counters.start();
+
+    while (seconds < 0.2) {
+        sink += round();
+        ops += opsPerRound;
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    }
+
+    std::vector<long long> values = counters.stop();
+    allocations = allocationCount - allocations;
+    benchSink = sink;
+
+    printf("%dx%d %-8s %-28s %10.2f %8.2f", side, side, representation, primitive, seconds * 1e9 / ops,
+           (double) allocations / ops);
+
+    for (long long value : values) {
+        if (value < 0) {
+            printf(" %10s", "-");
+        }
+        else {
+            printf(" %10.2f", (double) value / ops);
+        }
+    }
+
+    printf("\n");
+}
+
+// The primitives of one representation and heuristic on a corpus of boards.
+template <typename Board, typename Heuristic>
+void benchPuzzle(int side, const std::vector<std::vector<int>>& cells, PerfCounters& counters) {
+    typedef BasicPuzzle<Board, Heuristic> State;
+
+    int n = side * side - 1;
+    std::vector<State> corpus;
+
+    for (const std::vector<int>& board : cells) {
+        corpus.push_back(State(board, side, n));
+    }
+
+    std::vector<State> copies(corpus);
+    long long size = corpus.size();
+    std::string suffix = std::string("/") + Heuristic::name();
+
+    benchPrimitive(side, Board::name(), ("neighbours" + suffix).c_str(), size, counters, [&]() {
+        long long sum = 0;
+
+        for (State& p : corpus) {
+            sum += p.neighbours().size();
+        }
+
+        return sum;
+    });
+    benchPrimitive(side, Board::name(), ("estimate" + suffix).c_str(), size, counters, [&]() {
+        long long sum = 0;
+
+        for (State& p : corpus) {
+            sum += p.recomputeHeuristic();
+        }
+
+        return sum;
+    });
+
+    if (!Heuristic::lineTerms) {
+        return;
+    }
+
+    benchPrimitive(side, Board::name(), "manhattan", size, counters, [&]() {
+        long long sum = 0;
+
+        for (State& p : corpus) {
+            sum += p.manhattan();
+        }
+
+        return sum;
+    });
+    benchPrimitive(side, Board::name(), "hashValue", size, counters, [&]() {
+        long long sum = 0;
+
+        for (const State& p : corpus) {
+            sum += p.hashValue();
+        }
+
+        return sum;
+    });
+    benchPrimitive(side, Board::name(), "equals-same", size, counters, [&]() {
+        long long sum = 0;
+
+        for (long long k = 0; k < size; k++) {
+            sum += corpus[k].equals(copies[k]);
+        }
+
+        return sum;
+    });
+    benchPrimitive(side, Board::name(), "equals-different", size, counters, [&]() {
+        long long sum = 0;
+
+        for (long long k = 0; k < size; k++) {
+            sum += corpus[k].equals(copies[(k + 1) % size]);
+        }
+
+        return sum;
+    });
+    benchPrimitive(side, Board::name(), "isSolvable", size, counters, [&]() {
+        long long sum = 0;
+
+        for (const State& p : corpus) {
+            sum += p.isSolvable();
+        }
+
+        return sum;
+    });
+}
+
+// Whole solves with one engine, per board of the corpus.
+template <typename Board, typename Heuristic, typename Engine>
+void benchSolver(int side, const std::vector<Instance>& instances, PerfCounters& counters) {
+    std::string primitive = std::string("solve/") + Heuristic::name() + "/" + Engine::name();
+
+    benchPrimitive(side, Board::name(), primitive.c_str(), instances.size(), counters, [&]() {
+        long long sum = 0;
+
+        for (const Instance& instance : instances) {
+            sum += Solver<Board, Heuristic, Engine>::solve(instance).length;
+        }
+
+        return sum;
+    });
+}
+
+template <typename Board, typename Heuristic>
+void benchEngines(int side, const std::vector<Instance>& instances, PerfCounters& counters) {
+    benchSolver<Board, Heuristic, IdaEngine>(side, instances, counters);
+    benchSolver<Board, Heuristic, EpeaEngine>(side, instances, counters);
+    benchSolver<Board, Heuristic, RbfsEngine>(side, instances, counters);
+    benchSolver<Board, Heuristic, ControlledEngine>(side, instances, counters);
+}
+
+// Random probes into a 256 MB transposition table and random byte lookups in
+// a 1 GB table like a pattern database's, on base pages and then on huge
+// pages, each named after the page size actually obtained.
+void benchTables(PerfCounters& counters) {
+    const long long probes = 1 << 16;
+
+    for (bool huge : {false, true}) {
+        TranspositionTable table(24, huge);
+        TranspositionTable::Stats stats;
+        unsigned long long key = 1;
+        std::string primitive = "probeAndStore/" + std::to_string(table.getPageSize() >> 10) + "kB";
+
+        benchPrimitive(4, "tt", primitive.c_str(), probes, counters, [&]() {
+            long long sum = 0;
+
+            for (long long k = 0; k < probes; k++) {
+                key ^= key << 13;
+                key ^= key >> 7;
+                key ^= key << 17;
+                sum += table.probeAndStore(key, k & 63, stats);
+            }
+
+            return sum;
+        });
+
+        const size_t bytes = 1 << 30;
+        HugePageRegion region(bytes, huge);
+        const uint8_t* entries = static_cast<const uint8_t*>(region.data());
+
+        memset(region.data(), 1, bytes);
+        primitive = "lookup/" + std::to_string(region.getPageSize() >> 10) + "kB";
+
+        benchPrimitive(4, "pdb", primitive.c_str(), probes, counters, [&]() {
+            long long sum = 0;
+
+            for (long long k = 0; k < probes; k++) {
+                key ^= key << 13;
+                key ^= key >> 7;
+                key ^= key << 17;
+                sum += entries[key & (bytes - 1)];
+            }
+
+            return sum;
+        });
+    }
+}
+
+// IDA* iterations of the parallel engine's depth-first search on one thread
+// over a 1 GB transposition table, per expanded node, on base and on huge
+// pages, each without and with the children's entries prefetched: the
+// search throughput the page size and the prefetch make.
+void benchSearch(const Options& options, PerfCounters& counters) {
+    InstanceGenerator walks(4, 15, 60, 0, INT_MAX, options.seed);
+    std::vector<Puzzle> roots;
+    Instance instance;
+
+    for (int k = 0; k < 8; k++) {
+        walks.next(instance);
+        roots.push_back(Puzzle(instance.cells, instance.side, instance.pos0));
+    }
+
+    for (bool huge : {false, true}) {
+        TranspositionTable table(26, huge);
+        TranspositionTable::Stats stats;
+        std::atomic<bool> found(false);
+
+        auto search = [&]() {
+            long long expanded = 0;
+
+            for (Puzzle& root : roots) {
+                for (int limit = root.estimate(); limit != INT_MAX;) {
+                    Puzzle node = root;
+                    std::vector<Step> moves;
+
+                    table.nextGeneration();
+                    limit = parallelSearch(node, moves, 0, limit, table, stats, expanded, found, nullptr);
+
+                    if (limit == 0) {
+                        break;
+                    }
+                }
+            }
+
+            return expanded;
+        };
+
+        long long nodes = search();
+
+        for (bool prefetch : {false, true}) {
+            std::string primitive = "search/" + std::to_string(table.getPageSize() >> 10) + "kB/" +
+                                    (prefetch ? "prefetch" : "no-prefetch");
+
+            prefetchChildren = prefetch;
+            benchPrimitive(4, "tt", primitive.c_str(), nodes, counters, search);
+        }
+    }
+
+    prefetchChildren = true;
+}
+
+// The hot-path primitives of every representation and heuristic on
+// fixed-seed corpora of 1024 uniform random boards per size (--seed picks
+// another corpus), then every engine on 16 random 3x3 boards, then table
+// probes and searches through a table on base and huge pages, the searches
+// with and without prefetching. Output is one line per size, representation and
+// primitive, stable across builds so runs can be diffed.
+void benchPrimitives(const Options& options) {
+    PerfCounters counters;
+
+    printf("%-3s %-8s %-28s %10s %8s", "size", "repr", "primitive", "ns/op", "allocs");
+
+    for (int counter = 0; counter < PerfCounters::count; counter++) {
+        printf(" %10s", PerfCounters::name(counter));
+    }
+
+    printf("\n");
+
+    for (int side = 3; side <= 5; side++) {
+        int n = side * side - 1;
+        InstanceGenerator generator(side, n, 0, 0, INT_MAX, options.seed + side);
+        std::vector<std::vector<int>> cells;
+        Instance instance;
+
+        for (int k = 0; k < 1024; k++) {
+            generator.next(instance);
+            cells.push_back(instance.cells);
+        }
+
+        benchPuzzle<VectorBoard, ManhattanDistance>(side, cells, counters);
+        benchPuzzle<VectorBoard, LinearConflict>(side, cells, counters);
+        benchPuzzle<FlatBoard, ManhattanDistance>(side, cells, counters);
+        benchPuzzle<FlatBoard, LinearConflict>(side, cells, counters);
+
+        benchPrimitive(side, "cells", "isSolvable", cells.size(), counters, [&]() {
+            long long sum = 0;
+
+            for (const std::vector<int>& board : cells) {
+                sum += Puzzle::isSolvable(board, side, n);
+            }
+
+            return sum;
+        });
+    }
+
+    InstanceGenerator generator(3, 8, 0, 0, INT_MAX, options.seed);
+    std::vector<Instance> instances(16);
+
+    for (Instance& instance : instances) {
+        generator.next(instance);
+    }
+
+    benchEngines<VectorBoard, ManhattanDistance>(3, instances, counters);
+    benchEngines<VectorBoard, LinearConflict>(3, instances, counters);
+    benchEngines<FlatBoard, ManhattanDistance>(3, instances, counters);
+    benchEngines<FlatBoard, LinearConflict>(3, instances, counters);
+
+    benchTables(counters);
+    benchSearch(options, counters);
+}
+
+int main(int argc, char** argv) {
+    try {
+        benchPrimitives(parseOptions(argc, argv));
+        return 0;
+    }
+    catch (const char* message) {
+        fflush(stdout);
+        fprintf(stderr, "%s\n", message);
+        return 1;
+    }
+}
@@ -0,0 +1,494 @@
+#ifndef N_PUZZLE_HIERARCHY_H
+#define N_PUZZLE_HIERARCHY_H
+
+#include "puzzle.h"
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <tuple>
+#include <unordered_map>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Memo of exact abstract distances, bounded to a fixed number of slots in
+// 4-way sets chosen by the key; a full set is replaced with a CLOCK sweep
+// over the slots' referenced bits. Entries pushed out before they were saved,
+// and all unsaved ones when the cache closes, are appended to a spill file,
+// which the next run loads back, so warm-up carries over between runs. An
+// empty path keeps the memo in memory only. One lock serializes all threads.
+class AbstractionCache {
+public:
+    struct Stats {
+        long long lookups = 0;
+        long long hits = 0;
+        long long stores = 0;
+        long long evictions = 0;
+        long long spilled = 0;
+        long long loaded = 0;
+    };
+
+private:
+    static const uint32_t magic = 0x4148504e;
+    static const int ways = 4;
+
+    struct Slot {
+        uint64_t key;
+        uint16_t distance;
+        uint8_t saved;
+        uint8_t referenced;
+    };
+
+    struct Record {
+        uint64_t key;
+        uint32_t distance;
+        uint32_t reserved;
+    };
+
+    std::vector<Slot> slots;
+    uint32_t sets;
+    uint32_t hand;
+    int fd;
+    std::vector<Record> pending;
+    Stats stats;
+    mutable std::mutex lock;
+
+    static uint64_t mix(uint64_t key) {
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdULL;
+        key ^= key >> 33;
+
+        return key;
+    }
+
+    void spill() {
+        if (fd < 0 || pending.empty()) {
+            pending.clear();
+            return;
+        }
+
+        size_t bytes = pending.size() * sizeof(Record);
+
+        if (write(fd, pending.data(), bytes) != (ssize_t) bytes) {
+            throw "Cannot write abstraction spill file";
+        }
+
+        stats.spilled += pending.size();
+        pending.clear();
+    }
+
+    void insert(uint64_t key, int distance, bool saved) {
+        Slot* set = &slots[(mix(key) % sets) * ways];
+        Slot* slot = nullptr;
+
+        for (int w = 0; w < ways && !slot; w++) {
+            if (set[w].key == key || set[w].key == 0) {
+                slot = &set[w];
+            }
+        }
+
+        while (!slot) {
+            Slot& candidate = set[hand++ % ways];
+
+            if (candidate.referenced) {
+                candidate.referenced = 0;
+            }
+            else {
+                slot = &candidate;
+                stats.evictions++;
+
+                if (!slot->saved) {
+                    pending.push_back({slot->key, slot->distance, 0});
+                }
+            }
+        }
+
+        slot->key = key;
+        slot->distance = distance;
+        slot->saved = saved;
+        slot->referenced = 0;
+
+        if (pending.size() >= 4096) {
+            spill();
+        }
+    }
+
+public:
+    AbstractionCache(const std::string& path, uint32_t slotCount)
+        : slots(std::max<uint32_t>(ways, slotCount / ways * ways)), hand(0), fd(-1) {
+        sets = slots.size() / ways;
+
+        if (path.empty()) {
+            return;
+        }
+
+        fd = open(path.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+
+        if (fd < 0) {
+            throw "Cannot open abstraction spill file";
+        }
+
+        uint32_t existing = 0, header = magic;
+
+        if (pread(fd, &existing, sizeof(existing), 0) != sizeof(existing)) {
+            if (write(fd, &header, sizeof(header)) != sizeof(header)) {
+                ::close(fd);
+                throw "Cannot write abstraction spill file";
+            }
+        }
+        else if (existing != magic) {
+            ::close(fd);
+            throw "Not an abstraction spill file";
+        }
+
+        std::vector<Record> records(4096);
+        off_t offset = sizeof(header);
+        ssize_t got;
+
+        while ((got = pread(fd, records.data(), records.size() * sizeof(Record), offset)) >= (ssize_t) sizeof(Record)) {
+            for (ssize_t r = 0; r < got / (ssize_t) sizeof(Record); r++) {
+                insert(records[r].key, records[r].distance, true);
+                stats.loaded++;
+            }
+
+            offset += got / sizeof(Record) * sizeof(Record);
+        }
+    }
+
+    ~AbstractionCache() {
+        try {
+            close(true);
+        }
+        catch (const char* message) {
+            fprintf(stderr, "%s\n", message);
+        }
+    }
+
+    // Saves every unsaved entry. With final set, also closes the spill file.
+    void close(bool final) {
+        std::lock_guard<std::mutex> guard(lock);
+
+        for (Slot& slot : slots) {
+            if (slot.key != 0 && !slot.saved) {
+                pending.push_back({slot.key, slot.distance, 0});
+                slot.saved = 1;
+            }
+        }
+
+        spill();
+
+        if (final && fd >= 0) {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+
+    bool lookup(uint64_t key, int& distance) {
+        std::lock_guard<std::mutex> guard(lock);
+        Slot* set = &slots[(mix(key) % sets) * ways];
+
+        stats.lookups++;
+
+        for (int w = 0; w < ways; w++) {
+            if (set[w].key == key) {
+                set[w].referenced = 1;
+                distance = set[w].distance;
+                stats.hits++;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void store(uint64_t key, int distance) {
+        std::lock_guard<std::mutex> guard(lock);
+        stats.stores++;
+        insert(key, distance, false);
+    }
+
+    Stats getStats() const {
+        std::lock_guard<std::mutex> guard(lock);
+        return stats;
+    }
+};
+
+// Where the process's abstraction cache spills and how many slots it has;
+// read when the cache is first used.
+inline std::string abstractionSpill;
+inline uint32_t abstractionSlots = 1 << 22;
+
+inline AbstractionCache& abstractionCache() {
+    static AbstractionCache cache(abstractionSpill, abstractionSlots);
+    return cache;
+}
+
+// Hierarchical A* (Holte et al.) over an additive abstraction. The tiles are
+// split into groups of up to six in goal order, and the abstract state of a
+// group is the cells of its tiles alone: a move slides one of them into an
+// adjacent cell no other tile of the group holds. Every real move moves one
+// tile, so it is a move in exactly one group's space, and the sum of the
+// groups' distances is admissible.
+//
+// A group's distance is found the first time it is needed, by A* in its
+// space with the group's Manhattan distance as heuristic, raised to the exact
+// distance for states already in the cache. When the goal or such a state is
+// expanded, every state on the path to it gets its exact distance cached.
+// States are keyed by side (4 bits), pos0 (7 bits), group (5 bits) and the
+// cells of the group's tiles (8 bits each), so boards up to 11x11 fit.
+class Abstraction {
+private:
+    static const int groupTiles = 6;
+    static const int maxNodes = 1 << 20;
+
+    int side;
+    int pos0;
+    std::vector<std::vector<int>> groups;
+    std::vector<uint64_t> goals;
+    AbstractionCache& cache;
+    std::atomic<long long> searches;
+    std::atomic<long long> expanded;
+
+    uint64_t keyOf(int group, const std::vector<int>& cells) const {
+        uint64_t key = (uint64_t) side << 60 | (uint64_t) pos0 << 53 | (uint64_t) group << 48;
+
+        for (size_t t = 0; t < cells.size(); t++) {
+            key |= (uint64_t) cells[t] << (8 * t);
+        }
+
+        return key;
+    }
+
+    int cellOf(uint64_t key, int t) const {
+        return (key >> (8 * t)) & 0xff;
+    }
+
+    int manhattan(int group, uint64_t key) const {
+        int distance = 0;
+
+        for (size_t t = 0; t < groups[group].size(); t++) {
+            int cell = cellOf(key, t);
+            int goal = cellOf(goals[group], t);
+            distance += abs(cell / side - goal / side) + abs(cell % side - goal % side);
+        }
+
+        return distance;
+    }
+
+    struct Node {
+        uint64_t key;
+        int g;
+        int h;
+        bool exact;
+        int parent;
+    };
+
+    int search(int group, uint64_t root) {
+        std::vector<Node> nodes;
+        std::unordered_map<uint64_t, int> index;
+        std::priority_queue<std::tuple<int, int, int>,
+                            std::vector<std::tuple<int, int, int>>,
+                            std::greater<std::tuple<int, int, int>>> open;
+        int tiles = groups[group].size();
+        std::vector<char> occupied(side * side, 0);
+
+        searches++;
+        nodes.push_back({root, 0, manhattan(group, root), false, -1});
+        index[root] = 0;
+        open.push(std::make_tuple(nodes[0].h, 0, 0));
+
+        while (!open.empty()) {
+            int f = std::get<0>(open.top());
+            int g = -std::get<1>(open.top());
+            int n = std::get<2>(open.top());
+            open.pop();
+
+            if (g != nodes[n].g) {
+                continue;
+            }
+
+            if (nodes[n].key == goals[group] || nodes[n].exact) {
+                for (int m = n; m >= 0; m = nodes[m].parent) {
+                    cache.store(nodes[m].key, f - nodes[m].g);
+                }
+
+                return f;
+            }
+
+            // Too large to finish: the smallest f left is still a bound.
+            if ((int) nodes.size() > maxNodes) {
+                return f;
+            }
+
+            expanded++;
+
+            uint64_t key = nodes[n].key;
+
+            for (int t = 0; t < tiles; t++) {
+                occupied[cellOf(key, t)] = 1;
+            }
+
+            for (int t = 0; t < tiles; t++) {
+                int cell = cellOf(key, t);
+                int i = cell / side, j = cell % side;
+                const int di[] = {-1, 1, 0, 0};
+                const int dj[] = {0, 0, -1, 1};
+
+                for (int d = 0; d < 4; d++) {
+                    int ni = i + di[d], nj = j + dj[d];
+
+                    if (ni < 0 || ni >= side || nj < 0 || nj >= side || occupied[ni * side + nj]) {
+                        continue;
+                    }
+
+                    uint64_t next = (key & ~(0xffULL << (8 * t))) | (uint64_t) (ni * side + nj) << (8 * t);
+                    auto it = index.find(next);
+
+                    if (it == index.end()) {
+                        int distance;
+                        bool exact = cache.lookup(next, distance);
+                        int h = exact ? distance : manhattan(group, next);
+
+                        index[next] = nodes.size();
+                        nodes.push_back({next, g + 1, h, exact, n});
+                        open.push(std::make_tuple(g + 1 + h, -(g + 1), (int) nodes.size() - 1));
+                    }
+                    else if (nodes[it->second].g > g + 1) {
+                        Node& old = nodes[it->second];
+                        old.g = g + 1;
+                        old.parent = n;
+                        open.push(std::make_tuple(g + 1 + old.h, -(g + 1), it->second));
+                    }
+                }
+            }
+
+            for (int t = 0; t < tiles; t++) {
+                occupied[cellOf(key, t)] = 0;
+            }
+        }
+
+        throw "Abstract goal unreachable";
+    }
+
+public:
+    Abstraction(int otherSide, int otherPos0, AbstractionCache& otherCache)
+        : side(otherSide), pos0(otherPos0), cache(otherCache), searches(0), expanded(0) {
+        if (side > 11) {
+            throw "Abstractions hold boards up to 11x11";
+        }
+
+        int n = side * side - 1;
+
+        for (int tile = 1; tile <= n; tile += groupTiles) {
+            std::vector<int> tiles, cells;
+
+            for (int t = tile; t <= std::min(n, tile + groupTiles - 1); t++) {
+                tiles.push_back(t);
+                cells.push_back(goalCell(t, pos0));
+            }
+
+            groups.push_back(tiles);
+            goals.push_back(keyOf(groups.size() - 1, cells));
+        }
+    }
+
+    int getSide() const {
+        return side;
+    }
+
+    int getPos0() const {
+        return pos0;
+    }
+
+    long long getSearches() const {
+        return searches;
+    }
+
+    long long getExpanded() const {
+        return expanded;
+    }
+
+    // Sum over the groups of their exact abstract distances. A step changes
+    // one group, so the others repeat from the parent: each thread keeps the
+    // distances it used last in a small direct-mapped table in front of the
+    // shared cache, whose lock they then skip.
+    template <typename Board>
+    int estimate(const Board& board) {
+        static thread_local std::vector<int> where;
+        static thread_local std::vector<int> cells;
+        static thread_local std::vector<std::pair<uint64_t, int>> recent(1 << 12);
+        int total = 0;
+
+        where.resize(side * side);
+
+        for (int cell = 0; cell < side * side; cell++) {
+            where[board.get(cell / side, cell % side)] = cell;
+        }
+
+        for (size_t g = 0; g < groups.size(); g++) {
+            cells.clear();
+
+            for (int tile : groups[g]) {
+                cells.push_back(where[tile]);
+            }
+
+            uint64_t key = keyOf(g, cells);
+            std::pair<uint64_t, int>& last = recent[(key ^ key >> 29) & (recent.size() - 1)];
+
+            if (last.first != key) {
+                int distance;
+
+                if (!cache.lookup(key, distance)) {
+                    distance = search(g, key);
+                }
+
+                last = std::make_pair(key, distance);
+            }
+
+            total += last.second;
+        }
+
+        return total;
+    }
+};
+
+// Abstractions are built once per (side, pos0) and share the process's
+// cache, so their distances serve every instance of a batch.
+inline Abstraction& abstractionFor(int side, int pos0) {
+    static std::mutex lock;
+    static std::map<std::pair<int, int>, std::unique_ptr<Abstraction>> abstractions;
+
+    std::lock_guard<std::mutex> guard(lock);
+    std::unique_ptr<Abstraction>& abstraction = abstractions[std::make_pair(side, pos0)];
+
+    if (!abstraction) {
+        abstraction.reset(new Abstraction(side, pos0, abstractionCache()));
+    }
+
+    return *abstraction;
+}
+
+// Linear conflict, raised to the hierarchical abstraction bound.
+struct HierarchicalHeuristic : LinearConflict {
+    static const bool refines = true;
+
+    static const char* name() {
+        return "hierarchical";
+    }
+
+    template <typename Board>
+    static int refine(const Board& board, int side, int pos0, int additive) {
+        static thread_local Abstraction* last = nullptr;
+
+        if (!last || last->getSide() != side || last->getPos0() != pos0) {
+            last = &abstractionFor(side, pos0);
+        }
+
+        return std::max(additive, last->estimate(board));
+    }
+};
+
+#endif
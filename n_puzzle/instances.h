@@ -0,0 +1,737 @@
+#ifndef N_PUZZLE_INSTANCES_H
+#define N_PUZZLE_INSTANCES_H
+
+#include "puzzle.h"
+
+#include <atomic>
+#include <mutex>
+#include <sstream>
+#include <cstring>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Solutions shared between runs and processes through a memory-mapped file.
+// The file is a header followed by fixed-size slots grouped into 8-way sets
+// chosen by the board's key; a full set is replaced with a CLOCK sweep over
+// the slots' referenced bits. Writers serialize on flock(), readers take no
+// lock and retry on the slot's sequence number instead.
+class SolutionCache {
+public:
+    struct Entry {
+        int length;
+        int lowerBound;
+        std::string moves;
+    };
+
+private:
+    static const uint32_t magic = 0x435a504e;
+    static const int ways = 8;
+    static const int maxCells = 64;
+    static const int maxMoves = 416;
+    // A slot still being written after this many reads was left half
+    // written by a writer that died; it reads as a miss.
+    static const int maxRetries = 1 << 16;
+
+    struct Header {
+        uint32_t magic;
+        uint32_t slotCount;
+        std::atomic<uint32_t> hand;
+        uint32_t reserved;
+    };
+
+    struct Slot {
+        std::atomic<uint32_t> sequence;
+        std::atomic<uint8_t> referenced;
+        uint8_t side;
+        int16_t pos0;
+        int16_t length;
+        int16_t lowerBound;
+        uint64_t key;
+        uint8_t board[maxCells];
+        char moves[maxMoves];
+    };
+
+    int fd;
+    size_t bytes;
+    Header* header;
+    Slot* slots;
+    std::mutex writeLock;
+
+    static uint64_t canonicalKey(const Puzzle& p) {
+        uint64_t key = 14695981039346656037ULL;
+        int side = p.getSide();
+
+        key = (key ^ side) * 1099511628211ULL;
+        key = (key ^ (uint64_t) p.getPos0()) * 1099511628211ULL;
+
+        for (int i = 0; i < side; i++) {
+            for (int j = 0; j < side; j++) {
+                key = (key ^ (uint64_t) p.at(i, j)) * 1099511628211ULL;
+            }
+        }
+
+        return key;
+    }
+
+    static bool matches(const Slot& slot, const Puzzle& p, uint64_t key) {
+        int side = p.getSide();
+
+        if (slot.key != key || slot.side != side || slot.pos0 != p.getPos0()) {
+            return false;
+        }
+
+        for (int i = 0; i < side; i++) {
+            for (int j = 0; j < side; j++) {
+                if (slot.board[i * side + j] != p.at(i, j)) {
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    Slot* set(uint64_t key) const {
+        uint32_t sets = header->slotCount / ways;
+        return slots + (key % sets) * ways;
+    }
+
+public:
+    SolutionCache(const std::string& path, uint32_t slotCount) {
+        slotCount = std::max<uint32_t>(ways, slotCount / ways * ways);
+
+        fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+
+        if (fd < 0) {
+            throw "Cannot open solution cache";
+        }
+
+        flock(fd, LOCK_EX);
+
+        Header existing = {};
+        bool fresh = pread(fd, &existing, sizeof(uint32_t) * 2, 0) != sizeof(uint32_t) * 2 || existing.magic != magic;
+
+        if (!fresh) {
+            slotCount = existing.slotCount;
+        }
+
+        bytes = sizeof(Header) + (size_t) slotCount * sizeof(Slot);
+
+        if (fresh && ftruncate(fd, bytes) != 0) {
+            flock(fd, LOCK_UN);
+            close(fd);
+            throw "Cannot size solution cache";
+        }
+
+        void* memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+        if (memory == MAP_FAILED) {
+            flock(fd, LOCK_UN);
+            close(fd);
+            throw "Cannot map solution cache";
+        }
+
+        header = static_cast<Header*>(memory);
+        slots = reinterpret_cast<Slot*>(header + 1);
+
+        if (fresh) {
+            memset(memory, 0, bytes);
+            header->slotCount = slotCount;
+            header->magic = magic;
+        }
+
+        flock(fd, LOCK_UN);
+    }
+
+    ~SolutionCache() {
+        munmap(header, bytes);
+        close(fd);
+    }
+
+    SolutionCache(const SolutionCache&) = delete;
+    SolutionCache& operator=(const SolutionCache&) = delete;
+
+    bool lookup(const Puzzle& p, Entry& entry) const {
+        if (p.getSide() * p.getSide() > maxCells) {
+            return false;
+        }
+
+        uint64_t key = canonicalKey(p);
+        Slot* candidates = set(key);
+
+        for (int w = 0; w < ways; w++) {
+            Slot& slot = candidates[w];
+
+            for (int tries = 0; tries < maxRetries; tries++) {
+                uint32_t before = slot.sequence.load(std::memory_order_acquire);
+
+                if (before == 0) {
+                    break;
+                }
+                if (before & 1) {
+                    continue;
+                }
+
+                bool hit = matches(slot, p, key);
+                entry.length = slot.length;
+                entry.lowerBound = slot.lowerBound;
+                entry.moves.assign(slot.moves, std::max(0, (int) slot.length));
+
+                std::atomic_thread_fence(std::memory_order_acquire);
+
+                if (slot.sequence.load(std::memory_order_relaxed) != before) {
+                    continue;
+                }
+
+                if (hit) {
+                    slot.referenced.store(1, std::memory_order_relaxed);
+                    return true;
+                }
+
+                break;
+            }
+        }
+
+        return false;
+    }
+
+    void store(const Puzzle& p, const Entry& entry) {
+        if (p.getSide() * p.getSide() > maxCells || (int) entry.moves.size() > maxMoves) {
+            return;
+        }
+
+        uint64_t key = canonicalKey(p);
+        Slot* candidates = set(key);
+        Slot* victim = nullptr;
+
+        std::lock_guard<std::mutex> guard(writeLock);
+        flock(fd, LOCK_EX);
+
+        // Writers hold the file lock, so an odd sequence here belongs to a
+        // writer that died mid-store, and its slot is free to reclaim.
+        for (int w = 0; w < ways && !victim; w++) {
+            uint32_t sequence = candidates[w].sequence.load(std::memory_order_relaxed);
+
+            if (sequence == 0 || (sequence & 1) || matches(candidates[w], p, key)) {
+                victim = &candidates[w];
+            }
+        }
+
+        while (!victim) {
+            Slot& slot = candidates[header->hand.fetch_add(1, std::memory_order_relaxed) % ways];
+
+            if (slot.referenced.exchange(0, std::memory_order_relaxed) == 0) {
+                victim = &slot;
+            }
+        }
+
+        int side = p.getSide();
+        uint32_t sequence = victim->sequence.load(std::memory_order_relaxed);
+
+        if (sequence & 1) {
+            sequence++;
+        }
+
+        victim->sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        victim->side = side;
+        victim->pos0 = p.getPos0();
+        victim->length = entry.length;
+        victim->lowerBound = entry.lowerBound;
+        victim->key = key;
+        for (int i = 0; i < side; i++) {
+            for (int j = 0; j < side; j++) {
+                victim->board[i * side + j] = p.at(i, j);
+            }
+        }
+        memcpy(victim->moves, entry.moves.data(), entry.moves.size());
+        victim->referenced.store(1, std::memory_order_relaxed);
+
+        victim->sequence.store(sequence + 2, std::memory_order_release);
+
+        flock(fd, LOCK_UN);
+    }
+};
+
+struct Instance {
+    int side;
+    int pos0;
+    std::vector<int> cells;
+};
+
+// Largest side accepted on input, which bounds what one board can make the
+// reader allocate. Macro mode works on the cells alone and takes any of them.
+const int maxInstanceSide = 1024;
+
+// Largest side the engines take. A puzzle keeps one Zobrist word per tile
+// and cell, which is 128 MB at this size.
+const int maxPuzzleSide = 64;
+
+// Rejects a board whose cells are not a permutation of 0..side * side - 1,
+// or whose side or blank goal is out of range.
+inline void checkInstance(const Instance& instance) {
+    int n = instance.side * instance.side;
+
+    if (instance.side < 2 || instance.side > maxInstanceSide || (int) instance.cells.size() != n ||
+        instance.pos0 < 0 || instance.pos0 >= n) {
+        throw "Invalid board size";
+    }
+
+    std::vector<char> seen(n, 0);
+
+    for (int value : instance.cells) {
+        if (value < 0 || value >= n || seen[value]) {
+            throw "Board is not a permutation of 0..n";
+        }
+
+        seen[value] = 1;
+    }
+}
+
+// Rejects a board too large to build a puzzle for, before one is built.
+inline void checkPuzzleSide(const Instance& instance) {
+    if (instance.side > maxPuzzleSide) {
+        throw "Board too large for the search engines";
+    }
+}
+
+// Binary instance files: a BinaryHeader followed by count little-endian 64-bit
+// words, one per board, with cell c in bits 4c..4c+3. Boards up to 4x4 only.
+struct BinaryHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint8_t side;
+    uint8_t pos0;
+    uint64_t count;
+};
+
+const uint32_t binaryMagic = 0x425a504e;
+
+inline uint64_t packBoard(const std::vector<int>& cells) {
+    uint64_t word = 0;
+
+    for (size_t c = 0; c < cells.size(); c++) {
+        word |= (uint64_t) cells[c] << (4 * c);
+    }
+
+    return word;
+}
+
+// Writes instances in the text or the binary format. The binary header is
+// written up front and its count patched on close.
+class InstanceWriter {
+private:
+    FILE* out;
+    bool binary;
+    uint64_t count;
+    int side;
+    std::vector<char> buffer;
+    std::string text;
+
+public:
+    InstanceWriter(FILE* otherOut, bool otherBinary) : out(otherOut), binary(otherBinary), count(0), side(0), buffer(1 << 20) {
+        setvbuf(out, buffer.data(), _IOFBF, buffer.size());
+    }
+
+    ~InstanceWriter() {
+        close();
+    }
+
+    void write(const Instance& instance) {
+        if (binary) {
+            if (count == 0) {
+                if (instance.side > 4) {
+                    throw "Binary instances are limited to 4x4 boards";
+                }
+
+                side = instance.side;
+                BinaryHeader header = {binaryMagic, 1, (uint8_t) instance.side, (uint8_t) instance.pos0, 0};
+                fwrite(&header, sizeof(header), 1, out);
+            }
+
+            uint64_t word = packBoard(instance.cells);
+            fwrite(&word, sizeof(word), 1, out);
+        }
+        else {
+            // Formatted by hand into one write: fprintf per cell dominates
+            // when generating.
+            int n = instance.side * instance.side;
+            text.resize(32 + 12 * n);
+            char* end = &text[0] + snprintf(&text[0], 32, "%d\n%d\n", n - 1, instance.pos0);
+
+            for (int c = 0; c < n; c++) {
+                char digits[12];
+                int length = 0;
+                int value = instance.cells[c];
+
+                do {
+                    digits[length++] = '0' + value % 10;
+                    value /= 10;
+                } while (value > 0);
+
+                while (length > 0) {
+                    *end++ = digits[--length];
+                }
+
+                *end++ = (c + 1) % instance.side ? ' ' : '\n';
+            }
+
+            fwrite(text.data(), 1, end - text.data(), out);
+        }
+
+        count++;
+    }
+
+    void close() {
+        if (!out) {
+            return;
+        }
+
+        fflush(out);
+
+        if (binary && count > 0 && fseek(out, offsetof(BinaryHeader, count), SEEK_SET) == 0) {
+            fwrite(&count, sizeof(count), 1, out);
+        }
+
+        fflush(out);
+        setvbuf(out, nullptr, _IONBF, 0);
+        out = nullptr;
+    }
+};
+
+// Reads instances from a file mapped into memory, or from a large buffer
+// refilled from a stream, without going through iostreams. Accepts the text
+// format (n, pos0, then the cells) and the binary format above.
+class InstanceReader {
+private:
+    const char* begin;
+    const char* pos;
+    const char* end;
+    void* mapped;
+    size_t mappedBytes;
+    FILE* in;
+    std::vector<char> buffer;
+    bool binary;
+    BinaryHeader header;
+    uint64_t read;
+
+    void refill() {
+        if (!in || end - pos >= (1 << 20)) {
+            return;
+        }
+
+        size_t kept = end - pos;
+        memmove(buffer.data(), pos, kept);
+        size_t got = fread(buffer.data() + kept, 1, buffer.size() - kept, in);
+
+        if (got == 0) {
+            in = nullptr;
+        }
+
+        begin = pos = buffer.data();
+        end = begin + kept + got;
+    }
+
+    // True while input remains, refilling the buffer when it runs out, so a
+    // number is never cut at the end of a buffer.
+    bool more() {
+        if (pos == end) {
+            refill();
+        }
+
+        return pos < end;
+    }
+
+    bool nextInt(int& value) {
+        while (more() && (*pos == ' ' || *pos == '\n' || *pos == '\r' || *pos == '\t')) {
+            pos++;
+        }
+
+        if (!more()) {
+            return false;
+        }
+
+        bool negative = *pos == '-';
+        if (negative) {
+            pos++;
+        }
+
+        if (!more() || *pos < '0' || *pos > '9') {
+            throw "Malformed instance input";
+        }
+
+        value = 0;
+        while (more() && *pos >= '0' && *pos <= '9') {
+            if (value > (INT_MAX - 9) / 10) {
+                throw "Malformed instance input";
+            }
+
+            value = value * 10 + (*pos++ - '0');
+        }
+
+        if (negative) {
+            value = -value;
+        }
+
+        return true;
+    }
+
+public:
+    explicit InstanceReader(const std::string& path) : begin(nullptr), pos(nullptr), end(nullptr), mapped(nullptr),
+                                                       mappedBytes(0), in(nullptr), binary(false), header(), read(0) {
+        struct stat info;
+        int fd = path.empty() || path == "-" ? -1 : open(path.c_str(), O_RDONLY);
+
+        if (fd >= 0 && fstat(fd, &info) == 0 && info.st_size > 0) {
+            mappedBytes = info.st_size;
+            mapped = mmap(nullptr, mappedBytes, PROT_READ, MAP_PRIVATE, fd, 0);
+
+            if (mapped == MAP_FAILED) {
+                mapped = nullptr;
+            }
+            else {
+                madvise(mapped, mappedBytes, MADV_SEQUENTIAL);
+                begin = pos = static_cast<const char*>(mapped);
+                end = begin + mappedBytes;
+            }
+        }
+
+        if (!mapped) {
+            in = fd >= 0 ? fdopen(fd, "rb") : stdin;
+            fd = -1;
+            buffer.resize(4 << 20);
+            begin = pos = end = buffer.data();
+            refill();
+        }
+
+        if (fd >= 0) {
+            close(fd);
+        }
+
+        if (end - pos >= (long) sizeof(BinaryHeader) && memcmp(pos, &binaryMagic, sizeof(binaryMagic)) == 0) {
+            memcpy(&header, pos, sizeof(header));
+            pos += sizeof(header);
+            binary = true;
+
+            if (header.side < 2 || header.side > 4 || header.pos0 >= header.side * header.side) {
+                throw "Invalid binary instance header";
+            }
+        }
+    }
+
+    // Parses instances straight out of a caller-owned buffer.
+    InstanceReader(const char* data, size_t size) : begin(data), pos(data), end(data + size), mapped(nullptr),
+                                                    mappedBytes(0), in(nullptr), binary(false), header(), read(0) {
+    }
+
+    ~InstanceReader() {
+        if (mapped) {
+            munmap(mapped, mappedBytes);
+        }
+        if (in && in != stdin) {
+            fclose(in);
+        }
+    }
+
+    InstanceReader(const InstanceReader&) = delete;
+    InstanceReader& operator=(const InstanceReader&) = delete;
+
+    bool next(Instance& instance) {
+        refill();
+
+        if (binary) {
+            if (read == header.count || end - pos < 8) {
+                return false;
+            }
+
+            uint64_t word;
+            memcpy(&word, pos, sizeof(word));
+            pos += sizeof(word);
+            read++;
+
+            instance.side = header.side;
+            instance.pos0 = header.pos0;
+            instance.cells.resize(header.side * header.side);
+
+            for (size_t c = 0; c < instance.cells.size(); c++) {
+                instance.cells[c] = (word >> (4 * c)) & 15;
+            }
+
+            checkInstance(instance);
+
+            return true;
+        }
+
+        int n;
+
+        if (!nextInt(n)) {
+            return false;
+        }
+
+        if (!nextInt(instance.pos0)) {
+            throw "Malformed instance input";
+        }
+
+        if (instance.pos0 < 0 || instance.pos0 > n) {
+            instance.pos0 = n;
+        }
+
+        if (n < 3 || n >= maxInstanceSide * maxInstanceSide) {
+            throw "Invalid board size";
+        }
+
+        instance.side = sqrt(n + 1);
+
+        if (instance.side * instance.side != n + 1) {
+            throw "Invalid board size";
+        }
+
+        instance.cells.resize(instance.side * instance.side);
+
+        for (int& value : instance.cells) {
+            if (!nextInt(value)) {
+                throw "Malformed instance input";
+            }
+        }
+
+        checkInstance(instance);
+        read++;
+
+        return true;
+    }
+};
+
+// Random solvable instances. A uniform board shuffles every cell and, when
+// the result is unsolvable, swaps two tiles: that flips the parity and keeps
+// the distribution uniform over solvable boards. A walk board takes the given
+// number of random steps away from the goal, never undoing the previous one.
+// Either kind can be restricted to a range of the heuristic.
+class InstanceGenerator {
+private:
+    int side;
+    int pos0;
+    int walk;
+    int minHeuristic;
+    int maxHeuristic;
+    std::mt19937_64 random;
+
+    void shuffle(std::vector<int>& cells) {
+        for (int c = (int) cells.size() - 1; c > 0; c--) {
+            std::swap(cells[c], cells[random() % (c + 1)]);
+        }
+
+        if (!Puzzle::isSolvable(cells, side, pos0)) {
+            int a = cells[0] == 0 ? 1 : 0;
+            int b = cells[a + 1] == 0 ? a + 2 : a + 1;
+            std::swap(cells[a], cells[b]);
+        }
+    }
+
+    // The default puzzle's heuristic, the Manhattan distance plus linear
+    // conflicts, read straight off the cells so that no puzzle is built.
+    int heuristic(const std::vector<int>& cells) const {
+        struct Cells {
+            const std::vector<int>& cells;
+            int side;
+
+            int get(int i, int j) const {
+                return cells[i * side + j];
+            }
+        } board = {cells, side};
+        int h = 0;
+
+        for (int c = 0; c < side * side; c++) {
+            if (cells[c] != 0) {
+                int goal = goalCell(cells[c], pos0);
+                h += abs(goal / side - c / side) + abs(goal % side - c % side);
+            }
+        }
+
+        for (int i = 0; i < side; i++) {
+            h += LinearConflict::rowTerm(board, side, pos0, i) + LinearConflict::columnTerm(board, side, pos0, i);
+        }
+
+        return h;
+    }
+
+    // Walks the blank over the flat board; the heuristic is only needed once
+    // at the end, so no Puzzle is kept up to date along the way.
+    void randomWalk(std::vector<int>& cells) {
+        int blank = pos0;
+        int previous = -1;
+        unsigned long long bits = 0;
+
+        for (int k = 0, used = 32; k < walk; used++) {
+            if (used == 32) {
+                bits = random();
+                used = 0;
+            }
+
+            int next = blank;
+
+            switch ((bits >> (2 * used)) & 3) {
+                case 0: next -= blank >= side ? side : 0; break;
+                case 1: next += blank < side * (side - 1) ? side : 0; break;
+                case 2: next -= blank % side > 0 ? 1 : 0; break;
+                case 3: next += blank % side < side - 1 ? 1 : 0; break;
+            }
+
+            if (next != blank && next != previous) {
+                std::swap(cells[blank], cells[next]);
+                previous = blank;
+                blank = next;
+                k++;
+            }
+        }
+    }
+
+public:
+    InstanceGenerator(int otherSide, int otherPos0, int otherWalk, int otherMinHeuristic, int otherMaxHeuristic,
+                      unsigned long long seed)
+        : side(otherSide), pos0(otherPos0), walk(otherWalk), minHeuristic(otherMinHeuristic),
+          maxHeuristic(otherMaxHeuristic), random(seed) {
+        if (side < 2) {
+            throw "Boards must be at least 2x2";
+        }
+    }
+
+    void next(Instance& instance) {
+        instance.side = side;
+        instance.pos0 = pos0;
+        instance.cells.resize(side * side);
+
+        bool filtered = minHeuristic > 0 || maxHeuristic < INT_MAX;
+
+        for (int attempt = 0; attempt < 1000000; attempt++) {
+            for (int value = 0; value < side * side; value++) {
+                instance.cells[goalCell(value, pos0)] = value;
+            }
+
+            if (walk > 0) {
+                randomWalk(instance.cells);
+            }
+            else {
+                shuffle(instance.cells);
+            }
+
+            if (!filtered) {
+                return;
+            }
+
+            int h = heuristic(instance.cells);
+
+            if (h >= minHeuristic && h <= maxHeuristic) {
+                return;
+            }
+        }
+
+        throw "Difficulty filter rejected a million boards in a row";
+    }
+};
+
+#endif
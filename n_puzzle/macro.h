@@ -0,0 +1,392 @@
+#ifndef N_PUZZLE_MACRO_H
+#define N_PUZZLE_MACRO_H
+
+#include "instances.h"
+
+#include <ostream>
+#include <queue>
+
+// Non-optimal solver for boards far beyond the optimal engines. Rows are
+// placed top to bottom until two remain, then the columns of those two rows
+// left to right, then the last 2x2 block. A tile is walked to its cell by
+// routing the blank around it; the last two tiles of a line are finished in a
+// small window by an exhaustive search over their cells and the blank's. That
+// is O(side) moves per tile, O(n^1.5) in all, and the moves are written out
+// as they are made.
+class MacroSolver {
+private:
+    int side;
+    int pos0;
+    std::vector<int> board;
+    std::vector<int> where;
+    std::vector<char> locked;
+    int blank;
+    long long length;
+    std::ostream& out;
+    std::string pending;
+
+    // Moves the blank to an adjacent cell; the tile there moves the other way.
+    void moveBlank(int cell) {
+        char letter = cell == blank + side ? 'U' : (cell == blank - side ? 'D' : (cell == blank + 1 ? 'L' : 'R'));
+
+        board[blank] = board[cell];
+        where[board[cell]] = blank;
+        board[cell] = 0;
+        blank = cell;
+
+        emit(letter);
+    }
+
+    void emit(char letter) {
+        pending += letter;
+        length++;
+
+        if (pending.size() >= (1 << 16)) {
+            out.write(pending.data(), pending.size());
+            pending.clear();
+        }
+    }
+
+    bool isFree(int i, int j, int obstacle) const {
+        return i >= 0 && i < side && j >= 0 && j < side && !locked[i * side + j] && i * side + j != obstacle;
+    }
+
+    // Follows straight segments through the given corners when every cell on
+    // them is free; walk = false only checks.
+    bool followPath(const std::vector<std::pair<int, int>>& corners, int obstacle, bool walk) {
+        int i = blank / side, j = blank % side;
+
+        for (const std::pair<int, int>& corner : corners) {
+            while (i != corner.first || j != corner.second) {
+                if (i != corner.first) {
+                    i += i < corner.first ? 1 : -1;
+                }
+                else {
+                    j += j < corner.second ? 1 : -1;
+                }
+
+                if (!isFree(i, j, obstacle)) {
+                    return false;
+                }
+
+                if (walk) {
+                    moveBlank(i * side + j);
+                }
+            }
+        }
+
+        return true;
+    }
+
+    // Takes the blank to target without crossing locked cells or the
+    // obstacle: an L-shaped path when one is clear, else a detour through a
+    // line next to either end, else a breadth-first search.
+    void routeBlank(int target, int obstacle) {
+        int a = blank / side, b = blank % side;
+        int c = target / side, d = target % side;
+        std::vector<std::vector<std::pair<int, int>>> candidates = {
+            {{c, b}, {c, d}}, {{a, d}, {c, d}}
+        };
+
+        for (int x : {a - 1, a + 1, c - 1, c + 1}) {
+            candidates.push_back({{x, b}, {x, d}, {c, d}});
+        }
+        for (int y : {b - 1, b + 1, d - 1, d + 1}) {
+            candidates.push_back({{a, y}, {c, y}, {c, d}});
+        }
+
+        for (const std::vector<std::pair<int, int>>& corners : candidates) {
+            if (followPath(corners, obstacle, false)) {
+                followPath(corners, obstacle, true);
+                return;
+            }
+        }
+
+        searchBlank(target, obstacle);
+    }
+
+    void searchBlank(int target, int obstacle) {
+        std::vector<int> parent(side * side, -1);
+        std::queue<int> frontier;
+        parent[blank] = blank;
+        frontier.push(blank);
+
+        while (!frontier.empty() && parent[target] < 0) {
+            int cell = frontier.front();
+            frontier.pop();
+
+            int neighbours[] = {cell - side, cell + side, cell % side > 0 ? cell - 1 : -1,
+                                cell % side < side - 1 ? cell + 1 : -1};
+
+            for (int next : neighbours) {
+                if (next >= 0 && next < side * side && parent[next] < 0 &&
+                    isFree(next / side, next % side, obstacle)) {
+                    parent[next] = cell;
+                    frontier.push(next);
+                }
+            }
+        }
+
+        if (parent[target] < 0) {
+            throw "Macro solver cannot route the blank";
+        }
+
+        std::vector<int> path;
+
+        for (int cell = target; cell != blank; cell = parent[cell]) {
+            path.push_back(cell);
+        }
+
+        for (auto it = path.rbegin(); it != path.rend(); ++it) {
+            moveBlank(*it);
+        }
+    }
+
+    // Walks a tile to goal one cell at a time, sideways first.
+    void moveTile(int tile, int goal) {
+        while (where[tile] != goal) {
+            int i = where[tile] / side, j = where[tile] % side;
+            int di = goal / side - i, dj = goal % side - j;
+            int next;
+
+            if (dj != 0 && isFree(i, j + (dj > 0 ? 1 : -1), -1)) {
+                next = where[tile] + (dj > 0 ? 1 : -1);
+            }
+            else if (di != 0 && isFree(i + (di > 0 ? 1 : -1), j, -1)) {
+                next = where[tile] + (di > 0 ? side : -side);
+            }
+            else {
+                throw "Macro solver cannot move a tile";
+            }
+
+            routeBlank(next, where[tile]);
+            moveBlank(where[tile]);
+        }
+    }
+
+    bool inWindow(int cell, int top, int left, int rows, int cols) const {
+        int i = cell / side, j = cell % side;
+        return i >= top && i < top + rows && j >= left && j < left + cols;
+    }
+
+    // Brings the tracked tiles to their goals inside a window by a
+    // breadth-first search over their cells and the blank's (other tiles in
+    // the window are interchangeable), and the blank to blankGoal if it is
+    // not -1.
+    void finishWindow(int top, int left, int rows, int cols, const std::vector<int>& tiles,
+                      const std::vector<int>& goals, int blankGoal) {
+        int cells = rows * cols;
+        int k = tiles.size();
+        auto local = [&](int cell) { return (cell / side - top) * cols + cell % side - left; };
+        auto global = [&](int index) { return (top + index / cols) * side + left + index % cols; };
+
+        if (!inWindow(blank, top, left, rows, cols)) {
+            for (int tile : tiles) {
+                locked[where[tile]] = 1;
+            }
+
+            int target = -1;
+
+            for (int index = cells - 1; index >= 0 && target < 0; index--) {
+                if (!locked[global(index)]) {
+                    target = global(index);
+                }
+            }
+
+            routeBlank(target, -1);
+
+            for (int tile : tiles) {
+                locked[where[tile]] = 0;
+            }
+        }
+
+        // A state packs the blank's cell and then each tile's, base cells.
+        auto encode = [&](const std::vector<int>& positions) {
+            int state = 0;
+
+            for (int p : positions) {
+                state = state * cells + p;
+            }
+
+            return state;
+        };
+
+        int states = 1;
+
+        for (int t = 0; t <= k; t++) {
+            states *= cells;
+        }
+
+        std::vector<int> parent(states, -1);
+        std::vector<int> positions(k + 1);
+        positions[0] = local(blank);
+
+        for (int t = 0; t < k; t++) {
+            positions[t + 1] = local(where[tiles[t]]);
+        }
+
+        int first = encode(positions), found = -1;
+        std::queue<int> frontier;
+        parent[first] = first;
+        frontier.push(first);
+
+        while (!frontier.empty()) {
+            int state = frontier.front();
+            frontier.pop();
+
+            for (int t = k, rest = state; t >= 0; t--, rest /= cells) {
+                positions[t] = rest % cells;
+            }
+
+            bool done = blankGoal < 0 || positions[0] == local(blankGoal);
+
+            for (int t = 0; t < k; t++) {
+                done = done && positions[t + 1] == local(goals[t]);
+            }
+
+            if (done) {
+                found = state;
+                break;
+            }
+
+            int b = positions[0];
+            int neighbours[] = {b >= cols ? b - cols : -1, b + cols < cells ? b + cols : -1,
+                                b % cols > 0 ? b - 1 : -1, b % cols < cols - 1 ? b + 1 : -1};
+
+            for (int next : neighbours) {
+                if (next < 0) {
+                    continue;
+                }
+
+                std::vector<int> moved(positions);
+                moved[0] = next;
+
+                for (int t = 1; t <= k; t++) {
+                    if (moved[t] == next) {
+                        moved[t] = b;
+                    }
+                }
+
+                int code = encode(moved);
+
+                if (parent[code] < 0) {
+                    parent[code] = state;
+                    frontier.push(code);
+                }
+            }
+        }
+
+        if (found < 0) {
+            throw "Macro solver cannot finish a window";
+        }
+
+        std::vector<int> path;
+
+        for (int state = found; state != first; state = parent[state]) {
+            int b = state;
+
+            for (int t = 0; t < k; t++) {
+                b /= cells;
+            }
+
+            path.push_back(global(b));
+        }
+
+        for (auto it = path.rbegin(); it != path.rend(); ++it) {
+            moveBlank(*it);
+        }
+    }
+
+public:
+    // Tiles are renamed after their cells in the goal with the blank walked
+    // to the last cell, down and then right; solve() walks it back at the end.
+    MacroSolver(const Instance& instance, std::ostream& otherOut)
+        : side(instance.side), pos0(instance.pos0), board(instance.side * instance.side),
+          where(instance.side * instance.side), locked(instance.side * instance.side, 0), length(0),
+          out(otherOut) {
+        int n = side * side;
+        std::vector<int> goal(n);
+
+        for (int cell = 0; cell < n; cell++) {
+            goal[cell] = cell < pos0 ? cell + 1 : (cell == pos0 ? 0 : cell);
+        }
+
+        for (int cell = pos0; cell + side < n; cell += side) {
+            std::swap(goal[cell], goal[cell + side]);
+        }
+        for (int cell = (side - 1) * side + pos0 % side; cell + 1 < n; cell++) {
+            std::swap(goal[cell], goal[cell + 1]);
+        }
+
+        std::vector<int> label(n);
+
+        for (int cell = 0; cell < n; cell++) {
+            label[goal[cell]] = goal[cell] == 0 ? 0 : cell + 1;
+        }
+
+        for (int cell = 0; cell < n; cell++) {
+            board[cell] = label[instance.cells[cell]];
+            where[board[cell]] = cell;
+        }
+
+        blank = where[0];
+    }
+
+    long long getLength() const {
+        return length;
+    }
+
+    void solve() {
+        int s = side;
+
+        for (int r = 0; r + 2 < s; r++) {
+            for (int c = 0; c + 2 < s; c++) {
+                moveTile(r * s + c + 1, r * s + c);
+                locked[r * s + c] = 1;
+            }
+
+            int a = r * s + s - 2 + 1, b = r * s + s - 1 + 1;
+            moveTile(a, a - 1);
+            locked[a - 1] = 1;
+
+            if (!inWindow(where[b], r, s - 2, 3, 2)) {
+                moveTile(b, (r + 2) * s + s - 1);
+            }
+
+            locked[a - 1] = 0;
+            finishWindow(r, s - 2, 3, 2, {a, b}, {a - 1, b - 1}, -1);
+            locked[a - 1] = locked[b - 1] = 1;
+        }
+
+        for (int c = 0; c + 2 < s; c++) {
+            int a = (s - 2) * s + c + 1, b = (s - 1) * s + c + 1;
+            moveTile(a, a - 1);
+            locked[a - 1] = 1;
+
+            if (!inWindow(where[b], s - 2, c, 2, 3)) {
+                moveTile(b, (s - 1) * s + c + 2);
+            }
+
+            locked[a - 1] = 0;
+            finishWindow(s - 2, c, 2, 3, {a, b}, {a - 1, b - 1}, -1);
+            locked[a - 1] = locked[b - 1] = 1;
+        }
+
+        if (s >= 2) {
+            int a = (s - 2) * s + s - 2 + 1, b = a + 1, c = (s - 1) * s + s - 2 + 1;
+            finishWindow(s - 2, s - 2, 2, 2, {a, b, c}, {a - 1, b - 1, c - 1}, s * s - 1);
+        }
+
+        for (int j = s - 1; j > pos0 % s; j--) {
+            emit('R');
+        }
+        for (int i = s - 1; i > pos0 / s; i--) {
+            emit('D');
+        }
+
+        out.write(pending.data(), pending.size());
+        pending.clear();
+    }
+};
+
+#endif
@@ -0,0 +1,255 @@
+#include "service.h"
+#include "macro.h"
+#include "verify.h"
+
+// Runs IDA* and RBFS on the same instance and reports solution length,
+// expanded nodes and wall time for each.
+void compareEngines(Options options, Puzzle root) {
+    const std::string engines[] = {"ida", "rbfs"};
+
+    for (const std::string& engine : engines) {
+        options.engine = engine;
+        expandedNodes = 0;
+        auto begin = std::chrono::steady_clock::now();
+        std::pair<std::vector<Puzzle>, int> result = solve(options, root);
+        auto end = std::chrono::steady_clock::now();
+
+        std::cout << engine << ": length " << result.second
+                  << ", expanded " << expandedNodes
+                  << ", " << std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count() << " us"
+                  << std::endl;
+    }
+}
+
+// Runs frontier splitting ("parallel") and window search ("window") with 1,
+// 2, 4 ... up to the configured number of threads and reports each time with
+// its speedup over one thread of the same engine.
+void compareScaling(Options options, Puzzle root) {
+    const std::string engines[] = {"parallel", "window"};
+    int maxThreads = options.threads;
+
+    for (const std::string& engine : engines) {
+        long long single = 0;
+        options.engine = engine;
+
+        for (int threads = 1; ; threads = std::min(threads * 2, maxThreads)) {
+            options.threads = threads;
+            expandedNodes = 0;
+            auto begin = std::chrono::steady_clock::now();
+            std::pair<std::vector<Puzzle>, int> result = solve(options, root);
+            long long elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                                    std::chrono::steady_clock::now() - begin).count();
+
+            if (threads == 1) {
+                single = std::max(1LL, elapsed);
+            }
+
+            std::cout << engine << " threads " << threads << ": length " << result.second
+                      << ", expanded " << expandedNodes
+                      << ", " << elapsed << " us, speedup " << (double) single / std::max(1LL, elapsed)
+                      << std::endl;
+
+            if (threads == maxThreads) {
+                break;
+            }
+        }
+    }
+}
+
+// Generation mode: writes count boards to the --convert file (binary when it
+// ends in .bin) or as text to stdout.
+void generateInstances(const Options& options) {
+    int n = options.side * options.side - 1;
+    int pos0 = options.pos0 < 0 || options.pos0 > n ? n : options.pos0;
+    InstanceGenerator generator(options.side, pos0, options.walk, options.minHeuristic, options.maxHeuristic,
+                                options.seed);
+    bool binary = options.convert.size() > 4 && options.convert.substr(options.convert.size() - 4) == ".bin";
+    FILE* out = options.convert.empty() ? stdout : fopen(options.convert.c_str(), "wb");
+
+    if (!out) {
+        throw "Cannot open generator output";
+    }
+
+    std::cout.flush();
+
+    InstanceWriter writer(out, binary);
+    Instance instance;
+    auto begin = std::chrono::steady_clock::now();
+
+    for (long long k = 0; k < options.count; k++) {
+        generator.next(instance);
+        writer.write(instance);
+    }
+
+    writer.close();
+
+    if (out != stdout) {
+        fclose(out);
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    fprintf(stderr, "Generated %lld boards in %.3f s (%.0f boards/s)\n", options.count, seconds,
+            options.count / std::max(seconds, 1e-9));
+}
+
+// Pattern database mode: builds the table of --pattern (tiles separated by
+// commas, the blank is always tracked) for --side and --pos0 into --pdb, in
+// memory when it fits the --memory budget (MB) and on disk otherwise or with
+// --external.
+void buildPatternDatabase(const Options& options) {
+    if (options.pdb.empty() || options.pattern.empty()) {
+        throw "Pattern database mode needs --pdb and --pattern";
+    }
+
+    int n = options.side * options.side - 1;
+    int pos0 = options.pos0 < 0 || options.pos0 > n ? n : options.pos0;
+    PatternSpace space(options.side, options.pattern);
+    size_t memoryBytes = (size_t) options.memoryMb << 20;
+    bool external = options.external || space.size() > memoryBytes;
+    int maxDepth, runs = 0;
+    auto begin = std::chrono::steady_clock::now();
+
+    if (external) {
+        buildPatternDatabaseExternal(space, pos0, options.pdb, memoryBytes, maxDepth, runs);
+    }
+    else {
+        buildPatternDatabase(space, pos0, options.pdb, maxDepth);
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    fprintf(stderr, "Pattern database: %llu entries, max distance %d, %s build with %d runs in %.3f s\n",
+            (unsigned long long) space.size(), maxDepth, external ? "external" : "in-memory", runs, seconds);
+}
+
+// Macro mode: streams each board's moves on one line and reports the length
+// and rate on stderr. Unsolvable boards print -1. With --optimize the moves
+// are collected and shortened before they are printed.
+void solveByMacros(const Options& options, const Instance& instance) {
+    if (!Puzzle::isSolvable(instance.cells, instance.side, instance.pos0)) {
+        std::cout << -1 << '\n';
+        return;
+    }
+
+    std::ostringstream collected;
+    MacroSolver solver(instance, options.optimize > 0 ? collected : std::cout);
+    auto begin = std::chrono::steady_clock::now();
+
+    solver.solve();
+
+    if (options.optimize > 0) {
+        std::cout << optimizeMoves(options, instance.cells, instance.side, collected.str());
+    }
+
+    std::cout << '\n';
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    std::cout.flush();
+    fprintf(stderr, "Macro solution: %lld moves in %.3f s (%.0f moves/s)\n", solver.getLength(), seconds,
+            solver.getLength() / std::max(seconds, 1e-9));
+}
+
+int run(const Options& options) {
+    abstractionSpill = options.hierarchy;
+    abstractionSlots = options.hierarchySlots;
+
+    if (!options.connect.empty()) {
+        runClient(options);
+        return 0;
+    }
+
+    if (options.engine == "verify") {
+        return verifyHeuristics(options) > 0 ? 1 : 0;
+    }
+
+    if (options.engine == "pdb") {
+        buildPatternDatabase(options);
+        return 0;
+    }
+
+    if (options.engine == "generate") {
+        generateInstances(options);
+        return 0;
+    }
+
+    std::unique_ptr<SolutionCache> cache;
+
+    if (!options.cacheFile.empty()) {
+        cache.reset(new SolutionCache(options.cacheFile, options.cacheSlots));
+    }
+
+    if (!options.serve.empty()) {
+        SolverDaemon daemon(options, cache.get());
+        daemon.run(options.serve);
+        return 0;
+    }
+
+    InstanceReader reader(options.input);
+    Instance instance;
+
+    if (!options.convert.empty()) {
+        FILE* out = fopen(options.convert.c_str(), "wb");
+
+        if (!out) {
+            throw "Cannot open conversion output";
+        }
+
+        InstanceWriter writer(out, options.convert.size() > 4 && options.convert.substr(options.convert.size() - 4) == ".bin");
+
+        while (reader.next(instance)) {
+            writer.write(instance);
+        }
+
+        writer.close();
+        fclose(out);
+        return 0;
+    }
+
+    if (options.engine == "macro") {
+        while (reader.next(instance)) {
+            solveByMacros(options, instance);
+        }
+
+        return 0;
+    }
+
+    if (options.workers > 0 && options.engine != "compare" && options.engine != "scaling") {
+        runPipeline(options, reader, cache.get());
+        return 0;
+    }
+
+    while (reader.next(instance)) {
+        checkPuzzleSide(instance);
+        Puzzle p(instance.cells, instance.side, instance.pos0);
+
+        if (options.engine == "compare") {
+            compareEngines(options, p);
+        }
+        else if (options.engine == "scaling") {
+            compareScaling(options, p);
+        }
+        else {
+            SolutionCache::Entry entry = solveInstance(options, p, cache.get());
+            writeSolution(std::cout, options.output, p, entry.length, entry.moves);
+        }
+    }
+
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    std::ios::sync_with_stdio(false);
+
+    try {
+        return run(parseOptions(argc, argv));
+    }
+    catch (const char* message) {
+        std::cout.flush();
+        fprintf(stderr, "%s\n", message);
+        return 1;
+    }
+    catch (const std::exception& exception) {
+        std::cout.flush();
+        fprintf(stderr, "%s\n", exception.what());
+        return 1;
+    }
+}
@@ -0,0 +1,210 @@
+#ifndef N_PUZZLE_OPTIMIZE_H
+#define N_PUZZLE_OPTIMIZE_H
+
+#include "search.h"
+
+#include <atomic>
+#include <cstdio>
+
+// Shortens a solution that a non-optimal engine found. A move undone by the
+// next one is dropped, then the moves are cut into windows and each window
+// is replaced by an optimal path between the boards at its ends, found by
+// IDA* on the square of cells around the window's moves, with the start
+// board's tiles renamed after their cells in the end board. Windows are
+// independent, so they are searched in parallel, all under the caller's
+// deadline; a window not done by then keeps its moves. Passes alternate
+// between windows starting at 0 and at half a window, so detours across a
+// cut are seen by the next pass, until two passes in a row gain nothing or
+// the deadline passes.
+class PathOptimizer {
+public:
+    struct Stats {
+        long long cancelled = 0;
+        long long windows = 0;
+        long long shortened = 0;
+        long long pastDeadline = 0;
+        int passes = 0;
+    };
+
+private:
+    static const int maxPasses = 8;
+
+    int side;
+    int window;
+    int threads;
+    std::chrono::steady_clock::time_point deadline;
+    Stats stats;
+    std::atomic<long long> pastDeadline;
+
+    // Moves the blank as the tile letter says; the tile moves the other way.
+    void play(std::vector<int>& cells, int& blank, char letter) const {
+        int cell = letter == 'U' ? blank + side : (letter == 'D' ? blank - side : (letter == 'L' ? blank + 1 : blank - 1));
+
+        cells[blank] = cells[cell];
+        cells[cell] = 0;
+        blank = cell;
+    }
+
+    // Optimal moves from one board to the other within the smallest square,
+    // one cell wider on each side, around the cells the blank visits on the
+    // given moves; the tiles outside it do not move. The given moves are
+    // kept if the deadline passes first.
+    std::string shortest(const std::vector<int>& from, const std::vector<int>& to, const std::string& moves) {
+        std::vector<int> board(from);
+        int blank = std::find(board.begin(), board.end(), 0) - board.begin();
+        int top = blank / side, bottom = top, left = blank % side, right = left;
+
+        for (char c : moves) {
+            play(board, blank, c);
+            top = std::min(top, blank / side);
+            bottom = std::max(bottom, blank / side);
+            left = std::min(left, blank % side);
+            right = std::max(right, blank % side);
+        }
+
+        int crop = std::min(side, std::max(bottom - top, right - left) + 3);
+        int row = std::min(std::max(0, top - (crop - (bottom - top + 1)) / 2), side - crop);
+        int column = std::min(std::max(0, left - (crop - (right - left + 1)) / 2), side - crop);
+        int n = crop * crop;
+        std::vector<int> label(side * side);
+        std::vector<int> renamed(n);
+
+        for (int cell = 0; cell < n; cell++) {
+            if (to[(row + cell / crop) * side + column + cell % crop] == 0) {
+                blank = cell;
+            }
+        }
+        for (int cell = 0; cell < n; cell++) {
+            int tile = to[(row + cell / crop) * side + column + cell % crop];
+            label[tile] = tile == 0 ? 0 : (cell < blank ? cell + 1 : cell);
+        }
+        for (int cell = 0; cell < n; cell++) {
+            renamed[cell] = label[from[(row + cell / crop) * side + column + cell % crop]];
+        }
+
+        if (std::chrono::steady_clock::now() > deadline) {
+            pastDeadline++;
+            return moves;
+        }
+
+        try {
+            std::vector<Puzzle> path = idaStar(Puzzle(renamed, crop, blank)).first;
+            std::string best;
+
+            for (size_t i = 1; i < path.size(); i++) {
+                best += stepLetter(path[i - 1].stepTo(path[i]));
+            }
+
+            return best;
+        }
+        catch (const char*) {
+            pastDeadline++;
+            return moves;
+        }
+    }
+
+    // One pass over the windows starting at offset; returns the new moves.
+    std::string pass(const std::vector<int>& cells, const std::string& moves, size_t offset) {
+        std::vector<size_t> cuts;
+
+        for (size_t cut = offset; cut < moves.size(); cut += window) {
+            cuts.push_back(cut);
+        }
+
+        cuts.push_back(moves.size());
+
+        std::vector<std::vector<int>> boards;
+        std::vector<int> board(cells);
+        int blank = std::find(board.begin(), board.end(), 0) - board.begin();
+
+        for (size_t i = 0; i < moves.size(); i++) {
+            if (i == cuts[boards.size()]) {
+                boards.push_back(board);
+            }
+
+            play(board, blank, moves[i]);
+        }
+
+        boards.push_back(board);
+
+        std::vector<std::string> replaced(cuts.size() - 1);
+        std::atomic<size_t> next(0);
+        std::vector<std::thread> workers;
+
+        pastDeadline = 0;
+
+        for (int w = 0; w < threads; w++) {
+            workers.emplace_back([&]() {
+                searchDeadline = deadline;
+
+                for (size_t k = next++; k < replaced.size(); k = next++) {
+                    std::string original = moves.substr(cuts[k], cuts[k + 1] - cuts[k]);
+                    replaced[k] = shortest(boards[k], boards[k + 1], original);
+                }
+            });
+        }
+
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+
+        std::string shorter = moves.substr(0, cuts[0]);
+
+        for (size_t k = 0; k < replaced.size(); k++) {
+            if (replaced[k].size() < cuts[k + 1] - cuts[k]) {
+                stats.shortened++;
+            }
+
+            shorter += replaced[k];
+        }
+
+        stats.windows += replaced.size();
+        stats.pastDeadline += pastDeadline;
+        stats.passes++;
+
+        return shorter;
+    }
+
+public:
+    PathOptimizer(int otherSide, int otherWindow, int otherThreads,
+                  std::chrono::steady_clock::time_point otherDeadline = std::chrono::steady_clock::time_point::max())
+        : side(otherSide), window(std::max(2, otherWindow)), threads(std::max(1, otherThreads)),
+          deadline(otherDeadline), pastDeadline(0) {
+    }
+
+    // Drops every move that the next one undoes, repeatedly.
+    static std::string cancelInverses(const std::string& moves) {
+        std::string kept;
+
+        for (char c : moves) {
+            if (!kept.empty() && letterStep(kept.back()) == reverse(letterStep(c))) {
+                kept.pop_back();
+            }
+            else {
+                kept += c;
+            }
+        }
+
+        return kept;
+    }
+
+    std::string optimize(const std::vector<int>& cells, std::string moves) {
+        for (int k = 0, idle = 0; k < maxPasses && idle < 2 && std::chrono::steady_clock::now() < deadline; k++) {
+            std::string kept = cancelInverses(moves);
+
+            stats.cancelled += moves.size() - kept.size();
+
+            std::string shorter = pass(cells, kept, k % 2 == 0 ? 0 : window / 2);
+            idle = shorter.size() < moves.size() ? 0 : idle + 1;
+            moves = shorter;
+        }
+
+        return moves;
+    }
+
+    const Stats& getStats() const {
+        return stats;
+    }
+};
+
+#endif
@@ -0,0 +1,182 @@
+#ifndef N_PUZZLE_OPTIONS_H
+#define N_PUZZLE_OPTIONS_H
+
+#include "search.h"
+
+#include <sstream>
+
+struct Options {
+    std::string engine = "ida";
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    int tableBits = 22;
+    std::string cacheFile;
+    int cacheSlots = 1 << 16;
+    int perimeter = 0;
+    std::string input;
+    std::string convert;
+    std::string output = "moves";
+    int workers = 0;
+    int queueSize = 1024;
+    std::string serve;
+    std::string connect;
+    int deadlineMs = 0;
+    bool stats = false;
+    std::string checkpoint;
+    int checkpointInterval = 0;
+    int side = 3;
+    int pos0 = -1;
+    long long count = 1;
+    unsigned long long seed = 1;
+    int walk = 0;
+    int minHeuristic = 0;
+    int maxHeuristic = INT_MAX;
+    double growth = 2;
+    std::string pdb;
+    std::vector<int> pattern;
+    int memoryMb = 1024;
+    bool external = false;
+    std::string hierarchy;
+    int hierarchySlots = 1 << 22;
+    int optimize = 0;
+};
+
+// The engines and modes that may be named on the command line.
+inline bool isEngine(const std::string& name) {
+    static const char* names[] = {"ida", "epea", "rbfs", "parallel", "window", "resumable", "cr", "hida", "auto",
+                                  "macro", "compare", "scaling", "verify", "pdb", "generate"};
+
+    for (const char* known : names) {
+        if (name == known) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+inline Options parseOptions(int argc, char** argv) {
+    Options options;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+
+        if (arg.rfind("--threads=", 0) == 0) {
+            options.threads = std::max(1, std::stoi(arg.substr(10)));
+        }
+        else if (arg.rfind("--cache=", 0) == 0) {
+            options.cacheFile = arg.substr(8);
+        }
+        else if (arg.rfind("--cache-slots=", 0) == 0) {
+            options.cacheSlots = std::max(1, std::stoi(arg.substr(14)));
+        }
+        else if (arg.rfind("--output=", 0) == 0) {
+            options.output = arg.substr(9);
+        }
+        else if (arg == "--debug") {
+            debugOutput = true;
+            options.output = "boards";
+        }
+        else if (arg.rfind("--checkpoint=", 0) == 0) {
+            options.checkpoint = arg.substr(13);
+        }
+        else if (arg.rfind("--checkpoint-interval=", 0) == 0) {
+            options.checkpointInterval = std::max(0, std::stoi(arg.substr(22)));
+        }
+        else if (arg.rfind("--serve=", 0) == 0) {
+            options.serve = arg.substr(8);
+        }
+        else if (arg.rfind("--connect=", 0) == 0) {
+            options.connect = arg.substr(10);
+        }
+        else if (arg.rfind("--deadline=", 0) == 0) {
+            options.deadlineMs = std::max(0, std::stoi(arg.substr(11)));
+        }
+        else if (arg == "--stats") {
+            options.stats = true;
+        }
+        else if (arg.rfind("--workers=", 0) == 0) {
+            options.workers = std::max(1, std::stoi(arg.substr(10)));
+        }
+        else if (arg.rfind("--queue=", 0) == 0) {
+            options.queueSize = std::max(1, std::stoi(arg.substr(8)));
+        }
+        else if (arg.rfind("--input=", 0) == 0) {
+            options.input = arg.substr(8);
+        }
+        else if (arg.rfind("--convert=", 0) == 0) {
+            options.convert = arg.substr(10);
+        }
+        else if (arg.rfind("--perimeter=", 0) == 0) {
+            options.perimeter = std::max(0, std::stoi(arg.substr(12)));
+        }
+        else if (arg.rfind("--side=", 0) == 0) {
+            options.side = std::stoi(arg.substr(7));
+        }
+        else if (arg.rfind("--pos0=", 0) == 0) {
+            options.pos0 = std::stoi(arg.substr(7));
+        }
+        else if (arg.rfind("--count=", 0) == 0) {
+            options.count = std::max(0LL, std::stoll(arg.substr(8)));
+        }
+        else if (arg.rfind("--seed=", 0) == 0) {
+            options.seed = std::stoull(arg.substr(7));
+        }
+        else if (arg.rfind("--walk=", 0) == 0) {
+            options.walk = std::max(0, std::stoi(arg.substr(7)));
+        }
+        else if (arg.rfind("--min-h=", 0) == 0) {
+            options.minHeuristic = std::stoi(arg.substr(8));
+        }
+        else if (arg.rfind("--max-h=", 0) == 0) {
+            options.maxHeuristic = std::stoi(arg.substr(8));
+        }
+        else if (arg.rfind("--growth=", 0) == 0) {
+            options.growth = std::max(1.0, std::stod(arg.substr(9)));
+        }
+        else if (arg.rfind("--pdb=", 0) == 0) {
+            options.pdb = arg.substr(6);
+        }
+        else if (arg.rfind("--pattern=", 0) == 0) {
+            std::istringstream tiles(arg.substr(10));
+            std::string tile;
+
+            while (std::getline(tiles, tile, ',')) {
+                options.pattern.push_back(std::stoi(tile));
+            }
+        }
+        else if (arg.rfind("--memory=", 0) == 0) {
+            options.memoryMb = std::max(1, std::stoi(arg.substr(9)));
+        }
+        else if (arg == "--external") {
+            options.external = true;
+        }
+        else if (arg.rfind("--hierarchy=", 0) == 0) {
+            options.hierarchy = arg.substr(12);
+        }
+        else if (arg.rfind("--hierarchy-slots=", 0) == 0) {
+            options.hierarchySlots = std::max(1, std::stoi(arg.substr(18)));
+        }
+        else if (arg.rfind("--optimize=", 0) == 0) {
+            options.optimize = std::max(0, std::stoi(arg.substr(11)));
+        }
+        else if (arg == "--no-prefetch") {
+            prefetchChildren = false;
+        }
+        else if (arg == "--no-huge-pages") {
+            hugePageTables = false;
+        }
+        else if (arg.rfind("--tt-bits=", 0) == 0) {
+            options.tableBits = std::min(32, std::max(1, std::stoi(arg.substr(10))));
+        }
+        else if (isEngine(arg)) {
+            options.engine = arg;
+        }
+        else {
+            throw "Unknown option";
+        }
+    }
+
+    return options;
+}
+
+#endif
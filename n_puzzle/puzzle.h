@@ -0,0 +1,695 @@
+#ifndef N_PUZZLE_PUZZLE_H
+#define N_PUZZLE_PUZZLE_H
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <unordered_set>
+#include <random>
+#include <limits.h>
+#include <cstdint>
+#include <cstdlib>
+
+enum Step {
+    start,
+    up,
+    down,
+    left,
+    right
+};
+
+const Step steps[] = {up, down, left, right};
+
+inline Step reverse(Step s) {
+    switch (s) {
+        case up: return down;
+        case down: return up;
+        case left: return right;
+        case right: return left;
+        default: return start;
+    }
+}
+
+inline char stepLetter(Step s) {
+    switch (s) {
+        case up: return 'U';
+        case down: return 'D';
+        case left: return 'L';
+        case right: return 'R';
+        default: return '?';
+    }
+}
+
+inline Step letterStep(char c) {
+    switch (c) {
+        case 'U': return up;
+        case 'D': return down;
+        case 'L': return left;
+        case 'R': return right;
+        default: return start;
+    }
+}
+
+// Goal cell of a tile (or of the blank, value 0) when the blank ends in pos0.
+inline int goalCell(int value, int pos0) {
+    if (value == 0) {
+        return pos0;
+    }
+
+    return value <= pos0 ? value - 1 : value;
+}
+
+// Change of the Manhattan distance when the tile at cell moves one step,
+// indexed [(tile * cells + cell) * 4 + step - 1]. Shared by all puzzles of one
+// size and goal.
+inline const std::vector<int>& manhattanDeltas(int side, int pos0) {
+    static thread_local std::vector<int> table;
+    static thread_local int tableSide = -1;
+    static thread_local int tablePos0 = -1;
+
+    if (tableSide == side && tablePos0 == pos0) {
+        return table;
+    }
+
+    int cells = side * side;
+    table.assign(cells * cells * 4, 0);
+
+    for (int tile = 1; tile < cells; tile++) {
+        int goal = goalCell(tile, pos0);
+
+        for (int cell = 0; cell < cells; cell++) {
+            int i = cell / side;
+            int j = cell % side;
+
+            for (Step s : steps) {
+                int ni = i, nj = j;
+
+                switch (s) {
+                    case up: ni--; break;
+                    case down: ni++; break;
+                    case left: nj--; break;
+                    case right: nj++; break;
+                    default: break;
+                }
+
+                if (ni < 0 || ni >= side || nj < 0 || nj >= side) {
+                    continue;
+                }
+
+                int tileBefore = abs(goal / side - i) + abs(goal % side - j);
+                int tileAfter = abs(goal / side - ni) + abs(goal % side - nj);
+
+                table[(tile * cells + cell) * 4 + s - 1] = tileAfter - tileBefore;
+            }
+        }
+    }
+
+    tableSide = side;
+    tablePos0 = pos0;
+
+    return table;
+}
+
+// Zobrist keys, one random 64-bit word per (tile, cell). The key of a board
+// is the XOR of the words of its tiles, so a step updates it in O(1). Every
+// representation uses the same words, so keys agree between them.
+inline const std::vector<unsigned long long>& zobristTable(int cells) {
+    static thread_local std::vector<unsigned long long> table;
+
+    if ((int) table.size() < cells * cells) {
+        std::mt19937_64 random(0x9e3779b97f4a7c15ULL);
+        table.resize(cells * cells);
+
+        for (unsigned long long& k : table) {
+            k = random();
+        }
+    }
+
+    return table;
+}
+
+// Board representations. A puzzle reads, writes and swaps cells only through
+// get, set and swap, so any class with those (and ==) can hold the board.
+
+// One vector per row.
+class VectorBoard {
+private:
+    std::vector<std::vector<int>> rows;
+
+public:
+    static const char* name() {
+        return "vector";
+    }
+
+    explicit VectorBoard(int side) : rows(side, std::vector<int>(side)) {
+    }
+
+    int get(int i, int j) const {
+        return rows[i][j];
+    }
+
+    void set(int i, int j, int value) {
+        rows[i][j] = value;
+    }
+
+    void swap(int i1, int j1, int i2, int j2) {
+        std::swap(rows[i1][j1], rows[i2][j2]);
+    }
+
+    bool operator==(const VectorBoard& other) const {
+        return rows == other.rows;
+    }
+};
+
+// All cells in one row-major byte array: a single allocation per board and a
+// memcmp for equality. Holds boards up to 15x15.
+class FlatBoard {
+private:
+    int side;
+    std::vector<unsigned char> cells;
+
+public:
+    static const char* name() {
+        return "flat";
+    }
+
+    explicit FlatBoard(int otherSide) : side(otherSide), cells(otherSide * otherSide) {
+        if (side > 15) {
+            throw "Flat boards hold at most 15x15";
+        }
+    }
+
+    int get(int i, int j) const {
+        return cells[i * side + j];
+    }
+
+    void set(int i, int j, int value) {
+        cells[i * side + j] = value;
+    }
+
+    void swap(int i1, int j1, int i2, int j2) {
+        std::swap(cells[i1 * side + j1], cells[i2 * side + j2]);
+    }
+
+    bool operator==(const FlatBoard& other) const {
+        return cells == other.cells;
+    }
+};
+
+// Heuristics. Each is the Manhattan distance of the tiles plus a term summed
+// over rows and columns; a step changes that term on at most two lines, so
+// puzzles keep it up to date incrementally. lineTerms is false when the term
+// is always zero, which lets the update skip it entirely. A heuristic with
+// refines set may raise that sum further from the whole board through
+// refine(); it is called on every board a search evaluates.
+
+struct ManhattanDistance {
+    static const bool lineTerms = false;
+    static const bool refines = false;
+
+    static const char* name() {
+        return "manhattan";
+    }
+
+    template <typename Board>
+    static int rowTerm(const Board&, int, int, int) {
+        return 0;
+    }
+
+    template <typename Board>
+    static int columnTerm(const Board&, int, int, int) {
+        return 0;
+    }
+
+    template <typename Board>
+    static int refine(const Board&, int, int, int additive) {
+        return additive;
+    }
+};
+
+struct LinearConflict {
+    static const bool lineTerms = true;
+    static const bool refines = false;
+
+    static const char* name() {
+        return "linear-conflict";
+    }
+
+    // Fewest tiles that must leave a line so the rest can reach their goal
+    // cells in it: the tiles minus the longest run already in goal order.
+    // Each one costs two moves beyond the Manhattan distance.
+    static int lineConflicts(const std::vector<int>& order) {
+        static thread_local std::vector<int> tails;
+        tails.clear();
+
+        for (int goal : order) {
+            auto it = std::lower_bound(tails.begin(), tails.end(), goal);
+
+            if (it == tails.end()) {
+                tails.push_back(goal);
+            }
+            else {
+                *it = goal;
+            }
+        }
+
+        return order.size() - tails.size();
+    }
+
+    template <typename Board>
+    static int rowTerm(const Board& board, int side, int pos0, int i) {
+        static thread_local std::vector<int> order;
+        order.clear();
+
+        for (int j = 0; j < side; j++) {
+            if (board.get(i, j) != 0) {
+                int goal = goalCell(board.get(i, j), pos0);
+
+                if (goal / side == i) {
+                    order.push_back(goal % side);
+                }
+            }
+        }
+
+        return 2 * lineConflicts(order);
+    }
+
+    template <typename Board>
+    static int columnTerm(const Board& board, int side, int pos0, int j) {
+        static thread_local std::vector<int> order;
+        order.clear();
+
+        for (int i = 0; i < side; i++) {
+            if (board.get(i, j) != 0) {
+                int goal = goalCell(board.get(i, j), pos0);
+
+                if (goal % side == j) {
+                    order.push_back(goal / side);
+                }
+            }
+        }
+
+        return 2 * lineConflicts(order);
+    }
+
+    template <typename Board>
+    static int refine(const Board&, int, int, int additive) {
+        return additive;
+    }
+};
+
+template <typename Board, typename Heuristic>
+class BasicPuzzle {
+private:
+    Board board;
+    int side;
+    int pos0;
+    int heuristic;
+    int additive;
+    int row0;
+    int col0;
+    unsigned long long key;
+
+    unsigned long long zobrist(int tile, int i, int j) const {
+        int cells = side * side;
+        return zobristTable(cells)[tile * cells + i * side + j];
+    }
+
+    void computeKey() {
+        key = 0;
+
+        for (int i = 0; i < side; i++) {
+            for (int j = 0; j < side; j++) {
+                if (board.get(i, j) != 0) {
+                    key ^= zobrist(board.get(i, j), i, j);
+                }
+            }
+        }
+    }
+
+    void locateBlank() {
+        for (int i = 0; i < side; i++) {
+            for (int j = 0; j < side; j++) {
+                if (board.get(i, j) == 0) {
+                    row0 = i;
+                    col0 = j;
+                }
+            }
+        }
+    }
+
+    // Heuristic of the child on the given step, and the Manhattan distance plus
+    // line terms it was refined from.
+    int childHeuristic(Step s, int& childAdditive) {
+        int i, j;
+        stepSource(s, i, j);
+
+        int cells = side * side;
+        childAdditive = additive + manhattanDeltas(side, pos0)[(board.get(i, j) * cells + i * side + j) * 4 + s - 1];
+
+        if (!Heuristic::lineTerms && !Heuristic::refines) {
+            return childAdditive;
+        }
+
+        // A vertical step keeps the order of the tiles in every column and a
+        // horizontal one in every row, so only two lines can change.
+        if (Heuristic::lineTerms) {
+            if (i != row0) {
+                childAdditive -= Heuristic::rowTerm(board, side, pos0, i) +
+                                 Heuristic::rowTerm(board, side, pos0, row0);
+                board.swap(i, j, row0, col0);
+                childAdditive += Heuristic::rowTerm(board, side, pos0, i) +
+                                 Heuristic::rowTerm(board, side, pos0, row0);
+            }
+            else {
+                childAdditive -= Heuristic::columnTerm(board, side, pos0, j) +
+                                 Heuristic::columnTerm(board, side, pos0, col0);
+                board.swap(i, j, row0, col0);
+                childAdditive += Heuristic::columnTerm(board, side, pos0, j) +
+                                 Heuristic::columnTerm(board, side, pos0, col0);
+            }
+        }
+        else {
+            board.swap(i, j, row0, col0);
+        }
+
+        int h = Heuristic::refine(board, side, pos0, childAdditive);
+        board.swap(i, j, row0, col0);
+
+        return h;
+    }
+
+    // Cell of the tile that moves into the blank on the given step.
+    void stepSource(Step s, int& i, int& j) const {
+        i = row0;
+        j = col0;
+
+        switch (s) {
+            case up: i++; break;
+            case down: i--; break;
+            case left: j++; break;
+            case right: j--; break;
+            default: break;
+        }
+    }
+
+public:
+    typedef Board BoardType;
+    typedef Heuristic HeuristicType;
+
+    static int goalCell(int value, int pos0) {
+        return ::goalCell(value, pos0);
+    }
+
+    BasicPuzzle(const std::vector<std::vector<int>>& rows, int otherSide, int otherPos0)
+        : board(otherSide), side(otherSide), pos0(otherPos0), heuristic(-1), additive(0), row0(0), col0(0) {
+        for (int i = 0; i < side; i++) {
+            for (int j = 0; j < side; j++) {
+                board.set(i, j, rows[i][j]);
+            }
+        }
+
+        locateBlank();
+        computeKey();
+        estimate();
+    }
+
+    BasicPuzzle(const std::vector<int>& cells, int otherSide, int otherPos0)
+        : board(otherSide), side(otherSide), pos0(otherPos0), heuristic(-1), additive(0), row0(0), col0(0) {
+        for (int i = 0; i < side; i++) {
+            for (int j = 0; j < side; j++) {
+                board.set(i, j, cells[i * side + j]);
+            }
+        }
+
+        locateBlank();
+        computeKey();
+        estimate();
+    }
+
+    bool operator==(const BasicPuzzle& other) const {
+        return equals(other);
+    }
+
+    // The blank is not counted: it moves on every step, so counting it could
+    // overestimate the remaining moves.
+    int manhattan() const {
+        int manDist = 0;
+
+        for (int i = 0; i < side; i++) {
+            for (int j = 0; j < side; j++) {
+                if (board.get(i, j) != 0) {
+                    int goal = goalCell(board.get(i, j), pos0);
+                    manDist += abs(goal / side - i) + abs(goal % side - j);
+                }
+            }
+        }
+
+        return manDist;
+    }
+
+    int estimate() {
+        if (heuristic < 0) {
+            int lineTerms = 0;
+
+            for (int i = 0; Heuristic::lineTerms && i < side; i++) {
+                lineTerms += Heuristic::rowTerm(board, side, pos0, i) + Heuristic::columnTerm(board, side, pos0, i);
+            }
+
+            additive = manhattan() + lineTerms;
+            heuristic = Heuristic::refine(board, side, pos0, additive);
+        }
+
+        return heuristic;
+    }
+
+    // Drops the cached heuristic and computes it again from the board.
+    int recomputeHeuristic() {
+        heuristic = -1;
+        return estimate();
+    }
+
+    bool isGoal() {
+        return heuristic == 0;
+    }
+
+    static bool compare(BasicPuzzle& p1, BasicPuzzle& p2) {
+        return p1.heuristic < p2.heuristic;
+    }
+
+    bool canStep(Step s) const {
+        switch (s) {
+            case up: return row0 < side - 1;
+            case down: return row0 > 0;
+            case left: return col0 < side - 1;
+            case right: return col0 > 0;
+            default: return false;
+        }
+    }
+
+    // Operator-selection function: the change of the heuristic on the given
+    // step, computed without building the child.
+    int stepDelta(Step s) {
+        int childAdditive;
+        return childHeuristic(s, childAdditive) - heuristic;
+    }
+
+    // The same, also reporting the child's additive part, so that the step
+    // can then be made without computing the heuristic again.
+    int stepDelta(Step s, int& childAdditive) {
+        return childHeuristic(s, childAdditive) - heuristic;
+    }
+
+    void makeStep(Step s) {
+        int childAdditive;
+        int delta = stepDelta(s, childAdditive);
+        makeStep(s, delta, childAdditive);
+    }
+
+    // Makes the step with the delta and additive part stepDelta reported.
+    void makeStep(Step s, int delta, int childAdditive) {
+        int i, j;
+        heuristic += delta;
+        additive = childAdditive;
+        stepSource(s, i, j);
+        key ^= zobrist(board.get(i, j), i, j) ^ zobrist(board.get(i, j), row0, col0);
+        board.swap(i, j, row0, col0);
+        row0 = i;
+        col0 = j;
+    }
+
+    // The key of the child on the given step, without building it.
+    size_t childHash(Step s) const {
+        int i, j;
+        stepSource(s, i, j);
+        return key ^ zobrist(board.get(i, j), i, j) ^ zobrist(board.get(i, j), row0, col0);
+    }
+
+    void unmakeStep(Step s) {
+        makeStep(reverse(s));
+    }
+
+    BasicPuzzle child(Step s) const {
+        BasicPuzzle next(*this);
+        next.makeStep(s);
+        return next;
+    }
+
+    BasicPuzzle child(Step s, int delta, int childAdditive) const {
+        BasicPuzzle next(*this);
+        next.makeStep(s, delta, childAdditive);
+        return next;
+    }
+
+    // Builds only the children with heuristic <= maxHeuristic; the smallest
+    // heuristic above it is reported through minExceeded.
+    std::vector<BasicPuzzle> neighbours(int maxHeuristic, int& minExceeded) {
+        std::vector<BasicPuzzle> neighbours;
+        minExceeded = INT_MAX;
+
+        for (Step s : steps) {
+            if (!canStep(s)) {
+                continue;
+            }
+
+            int childAdditive;
+            int delta = stepDelta(s, childAdditive);
+            int h = heuristic + delta;
+
+            if (h > maxHeuristic) {
+                minExceeded = std::min(minExceeded, h);
+                continue;
+            }
+
+            neighbours.push_back(child(s, delta, childAdditive));
+        }
+
+        std::sort(neighbours.begin(), neighbours.end(), compare);
+
+        return neighbours;
+    }
+
+    std::vector<BasicPuzzle> neighbours() {
+        int minExceeded;
+        return neighbours(INT_MAX, minExceeded);
+    }
+
+    int getSide() const {
+        return side;
+    }
+
+    int getPos0() const {
+        return pos0;
+    }
+
+    int at(int i, int j) const {
+        return board.get(i, j);
+    }
+
+    // The step that turns this board into next, which must be a neighbour.
+    Step stepTo(const BasicPuzzle& next) const {
+        if (next.row0 > row0) return up;
+        if (next.row0 < row0) return down;
+        if (next.col0 > col0) return left;
+        if (next.col0 < col0) return right;
+        return start;
+    }
+
+    void print(std::ostream& out = std::cout) const {
+        for (int i = 0; i < side; i++) {
+            for (int j = 0; j < side; j++) {
+                out << board.get(i, j) << ' ';
+            }
+            out << '\n';
+        }
+    }
+
+    bool equals(const BasicPuzzle& other) const {
+        return side == other.side && key == other.key && board == other.board;
+    }
+
+    size_t hashValue() const {
+        return key;
+    }
+
+    // A step swaps the blank with a neighbour: one transposition of the
+    // cells that moves the blank one cell. A board is solvable exactly when
+    // the parity of its permutation away from the goal matches the parity of
+    // the blank's distance from its goal cell.
+    static bool isSolvable(const std::vector<int>& cells, int side, int pos0) {
+        static thread_local std::vector<uint64_t> seen;
+        int n = side * side;
+        int words = (n + 63) / 64;
+        uint64_t parity = 0;
+        int blank = 0;
+
+        seen.assign(words, 0);
+
+        // The inversions of a cell are the earlier cells with a higher goal:
+        // the bits above its own in seen. Only their parity matters, and the
+        // parity of a sum of popcounts is the popcount parity of the XOR.
+        for (int i = 0; i < n; i++) {
+            int goal = goalCell(cells[i], pos0);
+            int word = goal / 64;
+
+            parity ^= seen[word] >> (goal % 64) >> 1;
+
+            for (int w = word + 1; w < words; w++) {
+                parity ^= seen[w];
+            }
+
+            seen[word] |= 1ULL << (goal % 64);
+
+            if (cells[i] == 0) {
+                blank = i;
+            }
+        }
+
+        int distance = abs(blank / side - pos0 / side) + abs(blank % side - pos0 % side);
+
+        return (__builtin_popcountll(parity) + distance) % 2 == 0;
+    }
+
+    std::vector<int> cells() const {
+        std::vector<int> cells(side * side);
+
+        for (int cell = 0; cell < side * side; cell++) {
+            cells[cell] = board.get(cell / side, cell % side);
+        }
+
+        return cells;
+    }
+
+    bool isSolvable() const {
+        return isSolvable(cells(), side, pos0);
+    }
+};
+
+// The representation and heuristic every runtime-selected engine uses.
+typedef BasicPuzzle<VectorBoard, LinearConflict> Puzzle;
+
+struct PuzzleHasher {
+    template <typename State>
+    size_t operator()(const State& p) const {
+        return p.hashValue();
+    }
+};
+
+template <typename State>
+bool isUnique(const State& p, const std::unordered_set<State, PuzzleHasher>& visited) {
+    return visited.count(p) == 0;
+}
+
+template <typename State = Puzzle>
+State goalPuzzle(int side, int pos0) {
+    std::vector<std::vector<int>> board(side, std::vector<int>(side));
+
+    for (int cell = 0; cell < side * side; cell++) {
+        board[cell / side][cell % side] = cell < pos0 ? cell + 1 : (cell == pos0 ? 0 : cell);
+    }
+
+    return State(board, side, pos0);
+}
+
+#endif
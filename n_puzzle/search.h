@@ -0,0 +1,1151 @@
+#ifndef N_PUZZLE_SEARCH_H
+#define N_PUZZLE_SEARCH_H
+
+#include "tables.h"
+
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <queue>
+#include <tuple>
+#include <map>
+#include <csignal>
+
+inline thread_local long long expandedNodes = 0;
+inline thread_local std::chrono::steady_clock::time_point searchDeadline = std::chrono::steady_clock::time_point::max();
+
+// Counts an expansion and, every 4096 of them, gives up the search if the
+// thread's deadline has passed.
+inline void countExpansion(long long& expanded) {
+    if ((++expanded & 4095) == 0 && std::chrono::steady_clock::now() > searchDeadline) {
+        throw "Deadline exceeded";
+    }
+}
+inline bool debugOutput = false;
+inline bool prefetchChildren = true;
+
+template <typename State>
+int aStar(std::vector<State>& path, int g, int limit, const PerimeterDatabase* perimeter = nullptr) {
+    State lastNode = path.back();
+    std::unordered_set<State, PuzzleHasher> visited;
+
+    if (lastNode.isGoal()) {
+        return 0;
+    }
+
+    int f = g + lastNode.estimate();
+
+    if (perimeter) {
+        int d = perimeter->distance(lastNode);
+
+        if (d >= 0) {
+            if (g + d > limit) {
+                return g + d;
+            }
+
+            for (Step s : perimeter->descend(lastNode)) {
+                path.push_back(path.back().child(s));
+            }
+
+            return 0;
+        }
+
+        f = std::max(f, g + perimeter->getRadius() + 1);
+    }
+
+    if (f > limit) {
+        return f;
+    }
+
+    countExpansion(expandedNodes);
+
+    int min = INT_MAX;
+
+    std::vector<State> next = lastNode.neighbours(limit - g - 1, min);
+
+    if (min != INT_MAX) {
+        min += g + 1;
+    }
+
+    int t;
+
+    for (State n : next) {
+        if (isUnique(n, visited)) {
+            path.push_back(n);
+            visited.insert(n);
+
+            t = aStar(path, g + 1, limit, perimeter);
+
+            if (t == 0) {
+                return t;
+            }
+            
+            if (t < min) {
+                min = t;
+            }
+            path.pop_back();
+        }
+    }
+
+    return min;
+}
+
+template <typename State>
+std::pair<std::vector<State>, int> idaStar(State root, const PerimeterDatabase* perimeter = nullptr) {
+    if (debugOutput) {
+        std::cout << "Starting!" << std::endl;
+    }
+    std::vector<State> path;
+
+    if (!root.isSolvable()) {
+        return std::pair<std::vector<State>, int> (path, -1); 
+    }
+
+    if (debugOutput) {
+        root.print();
+    }
+
+    path.push_back(root);
+
+    if (root.isGoal()) {
+        return std::pair<std::vector<State>, int> (path, 0);
+    }
+
+    int limit = root.estimate();
+
+    while (!path.back().isGoal()) {
+        if (debugOutput) {
+            std::cout << "Searching with limit " << limit << std::endl;
+        }
+        limit = aStar(path, 0, limit, perimeter);
+    }
+
+    return std::pair<std::vector<State>, int> (path, path.size() - 1);
+} 
+
+template <typename State>
+struct SearchNode {
+    State state;
+    int g;
+    int f;
+    int expandedF;
+    int parent;
+};
+
+template <typename State>
+std::pair<std::vector<State>, int> epeaStar(State root) {
+    if (debugOutput) {
+        std::cout << "Starting!" << std::endl;
+    }
+    std::vector<State> path;
+
+    if (!root.isSolvable()) {
+        return std::pair<std::vector<State>, int> (path, -1);
+    }
+
+    if (debugOutput) {
+        root.print();
+    }
+
+    std::vector<SearchNode<State>> nodes;
+    std::unordered_map<State, int, PuzzleHasher> stored;
+    std::priority_queue<std::tuple<int, int, int>,
+                        std::vector<std::tuple<int, int, int>>,
+                        std::greater<std::tuple<int, int, int>>> open;
+    long long generated = 0;
+
+    nodes.push_back({root, 0, root.estimate(), INT_MIN, -1});
+    stored[root] = 0;
+    open.push(std::make_tuple(nodes[0].f, 0, 0));
+
+    while (!open.empty()) {
+        int F = std::get<0>(open.top());
+        int index = std::get<2>(open.top());
+        open.pop();
+
+        if (nodes[index].f != F) {
+            continue;
+        }
+
+        State state = nodes[index].state;
+        int g = nodes[index].g;
+        int lastF = nodes[index].expandedF;
+
+        if (state.isGoal()) {
+            if (debugOutput) {
+                fprintf(stderr, "Generated %lld nodes, stored %zu\n", generated, nodes.size());
+            }
+
+            for (int i = index; i >= 0; i = nodes[i].parent) {
+                path.push_back(nodes[i].state);
+            }
+            std::reverse(path.begin(), path.end());
+
+            return std::pair<std::vector<State>, int> (path, g);
+        }
+
+        countExpansion(expandedNodes);
+
+        int nextF = INT_MAX;
+        int h = state.estimate();
+
+        for (Step s : steps) {
+            if (!state.canStep(s)) {
+                continue;
+            }
+
+            int childAdditive;
+            int delta = state.stepDelta(s, childAdditive);
+            int childF = g + 1 + h + delta;
+
+            if (childF <= lastF) {
+                continue;
+            }
+
+            if (childF > F) {
+                nextF = std::min(nextF, childF);
+                continue;
+            }
+
+            State next = state.child(s, delta, childAdditive);
+            generated++;
+
+            auto it = stored.find(next);
+
+            if (it == stored.end()) {
+                stored[next] = nodes.size();
+                nodes.push_back({next, g + 1, childF, INT_MIN, index});
+                open.push(std::make_tuple(childF, -(g + 1), (int) nodes.size() - 1));
+            }
+            else if (nodes[it->second].g > g + 1) {
+                SearchNode<State>& old = nodes[it->second];
+                old.g = g + 1;
+                old.f = childF;
+                old.expandedF = INT_MIN;
+                old.parent = index;
+                open.push(std::make_tuple(childF, -(g + 1), it->second));
+            }
+        }
+
+        nodes[index].expandedF = F;
+        nodes[index].f = nextF;
+
+        if (nextF != INT_MAX) {
+            open.push(std::make_tuple(nextF, -g, index));
+        }
+    }
+
+    return std::pair<std::vector<State>, int> (path, -1);
+}
+
+// Recursive best-first search: F is the stored (backed-up) value of the node,
+// bound the best alternative f elsewhere in the tree. Returns the new backed-up
+// value of the node; found is set once the goal is reached and moves then holds
+// the solution.
+template <typename State>
+int rbfs(State& node, std::vector<Step>& moves, int g, int F, int bound, bool& found) {
+    int f = g + node.estimate();
+
+    if (f > bound) {
+        return f;
+    }
+
+    if (node.isGoal()) {
+        found = true;
+        return f;
+    }
+
+    countExpansion(expandedNodes);
+
+    std::vector<std::pair<int, Step>> children;
+    Step back = moves.empty() ? start : reverse(moves.back());
+
+    for (Step s : steps) {
+        if (s == back || !node.canStep(s)) {
+            continue;
+        }
+
+        int childF = g + 1 + node.estimate() + node.stepDelta(s);
+
+        if (f < F) {
+            childF = std::max(F, childF);
+        }
+
+        children.push_back(std::make_pair(childF, s));
+    }
+
+    if (children.empty()) {
+        return INT_MAX;
+    }
+
+    std::sort(children.begin(), children.end());
+
+    while (children[0].first <= bound && children[0].first != INT_MAX) {
+        int alternative = children.size() > 1 ? children[1].first : INT_MAX;
+        Step s = children[0].second;
+
+        node.makeStep(s);
+        moves.push_back(s);
+
+        children[0].first = rbfs(node, moves, g + 1, children[0].first, std::min(bound, alternative), found);
+
+        if (found) {
+            return children[0].first;
+        }
+
+        moves.pop_back();
+        node.unmakeStep(s);
+
+        std::sort(children.begin(), children.end());
+    }
+
+    return children[0].first;
+}
+
+template <typename State>
+std::pair<std::vector<State>, int> rbfsStar(State root) {
+    if (debugOutput) {
+        std::cout << "Starting!" << std::endl;
+    }
+    std::vector<State> path;
+
+    if (!root.isSolvable()) {
+        return std::pair<std::vector<State>, int> (path, -1);
+    }
+
+    if (debugOutput) {
+        root.print();
+    }
+
+    std::vector<Step> moves;
+    State node = root;
+    bool found = false;
+
+    rbfs(node, moves, 0, root.estimate(), INT_MAX, found);
+
+    if (!found) {
+        return std::pair<std::vector<State>, int> (path, -1);
+    }
+
+    path.push_back(root);
+    for (Step s : moves) {
+        path.push_back(path.back().child(s));
+    }
+
+    return std::pair<std::vector<State>, int> (path, moves.size());
+}
+
+template <typename State>
+int parallelSearch(State& node, std::vector<Step>& moves, int g, int limit, TranspositionTable& table,
+                   TranspositionTable::Stats& stats, long long& expanded, std::atomic<bool>& found,
+                   const PerimeterDatabase* perimeter) {
+    int f = g + node.estimate();
+
+    if (perimeter) {
+        int d = perimeter->distance(node);
+
+        if (d >= 0) {
+            if (g + d > limit) {
+                return g + d;
+            }
+
+            for (Step s : perimeter->descend(node)) {
+                node.makeStep(s);
+                moves.push_back(s);
+            }
+
+            return 0;
+        }
+
+        f = std::max(f, g + perimeter->getRadius() + 1);
+    }
+
+    if (f > limit) {
+        return f;
+    }
+
+    if (node.isGoal()) {
+        return 0;
+    }
+
+    if (found.load(std::memory_order_relaxed) || table.probeAndStore(node.hashValue(), g, stats)) {
+        return INT_MAX;
+    }
+
+    countExpansion(expanded);
+
+    std::vector<std::pair<int, Step>> children;
+    Step back = moves.empty() ? start : reverse(moves.back());
+
+    // The table entries of the children within the limit are prefetched as
+    // soon as their heuristic is known, so their misses overlap with each
+    // other and with the rest of the expansion instead of stalling each
+    // child's probe in turn.
+    for (Step s : steps) {
+        if (s != back && node.canStep(s)) {
+            int delta = node.stepDelta(s);
+
+            if (prefetchChildren && g + 1 + node.estimate() + delta <= limit) {
+                table.prefetch(node.childHash(s));
+            }
+
+            children.push_back(std::make_pair(delta, s));
+        }
+    }
+
+    std::sort(children.begin(), children.end());
+
+    int min = INT_MAX;
+
+    for (std::pair<int, Step> child : children) {
+        node.makeStep(child.second);
+        moves.push_back(child.second);
+
+        int t = parallelSearch(node, moves, g + 1, limit, table, stats, expanded, found, perimeter);
+
+        if (t == 0) {
+            return t;
+        }
+
+        moves.pop_back();
+        node.unmakeStep(child.second);
+
+        min = std::min(min, t);
+    }
+
+    return min;
+}
+
+// IDA* over a breadth-first frontier of the root: every iteration the threads
+// take frontier nodes from a shared counter and search them with the same
+// limit, deduplicating through one TranspositionTable.
+template <typename State>
+std::pair<std::vector<State>, int> parallelIdaStar(State root, int threads, int tableBits,
+                                                   const PerimeterDatabase* perimeter = nullptr) {
+    if (debugOutput) {
+        std::cout << "Starting!" << std::endl;
+    }
+    std::vector<State> path;
+
+    if (!root.isSolvable()) {
+        return std::pair<std::vector<State>, int> (path, -1);
+    }
+
+    if (debugOutput) {
+        root.print();
+    }
+
+    std::vector<Step> solution;
+    std::vector<std::vector<Step>> frontier(1);
+    bool solved = root.isGoal();
+
+    while (!solved && frontier.size() < (size_t) threads * 16) {
+        std::vector<std::vector<Step>> layer;
+
+        for (const std::vector<Step>& moves : frontier) {
+            State node = root;
+            for (Step s : moves) {
+                node.makeStep(s);
+            }
+
+            Step back = moves.empty() ? start : reverse(moves.back());
+
+            for (Step s : steps) {
+                if (s == back || !node.canStep(s)) {
+                    continue;
+                }
+
+                layer.push_back(moves);
+                layer.back().push_back(s);
+
+                if (node.child(s).isGoal()) {
+                    solution = layer.back();
+                    solved = true;
+                }
+            }
+        }
+
+        frontier.swap(layer);
+    }
+
+    TranspositionTable table(tableBits);
+    TranspositionTable::Stats total;
+    int limit = root.estimate();
+
+    while (!solved && limit != INT_MAX) {
+        if (debugOutput) {
+            std::cout << "Searching with limit " << limit << std::endl;
+        }
+
+        std::atomic<size_t> next(0);
+        std::atomic<int> minExceeded(INT_MAX);
+        std::atomic<bool> found(false);
+        std::mutex solutionLock;
+        std::vector<TranspositionTable::Stats> stats(threads);
+        std::vector<long long> expanded(threads, 0);
+        std::vector<std::thread> workers;
+        std::atomic<bool> timedOut(false);
+        std::chrono::steady_clock::time_point deadline = searchDeadline;
+
+        table.nextGeneration();
+
+        for (int w = 0; w < threads; w++) {
+            workers.push_back(std::thread([&, w]() {
+                size_t k;
+
+                searchDeadline = deadline;
+
+                try {
+                    while ((k = next.fetch_add(1)) < frontier.size() && !found.load()) {
+                        State node = root;
+                        std::vector<Step> moves = frontier[k];
+
+                        for (Step s : moves) {
+                            node.makeStep(s);
+                        }
+
+                        int t = parallelSearch(node, moves, moves.size(), limit, table, stats[w], expanded[w], found, perimeter);
+
+                        if (t == 0) {
+                            std::lock_guard<std::mutex> guard(solutionLock);
+                            if (!found.exchange(true)) {
+                                solution = moves;
+                            }
+                        }
+                        else {
+                            int seen = minExceeded.load();
+                            while (t < seen && !minExceeded.compare_exchange_weak(seen, t)) {
+                            }
+                        }
+                    }
+                }
+                catch (const char*) {
+                    timedOut.store(true);
+                    found.store(true);
+                }
+            }));
+        }
+
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+
+        for (int w = 0; w < threads; w++) {
+            total.add(stats[w]);
+            expandedNodes += expanded[w];
+        }
+
+        if (timedOut.load()) {
+            throw "Deadline exceeded";
+        }
+
+        solved = found.load();
+        limit = minExceeded.load();
+    }
+
+    if (debugOutput && total.probes > 0) {
+        fprintf(stderr, "Transposition table: %lld probes, %g%% hits, %g%% collisions, %zu kB pages\n", total.probes,
+                100.0 * total.hits / total.probes, 100.0 * total.collisions / total.probes, table.getPageSize() >> 10);
+    }
+
+    if (!solved) {
+        return std::pair<std::vector<State>, int> (path, -1);
+    }
+
+    path.push_back(root);
+    for (Step s : solution) {
+        path.push_back(path.back().child(s));
+    }
+
+    return std::pair<std::vector<State>, int> (path, solution.size());
+}
+
+// Depth-first search of one window of the parallel window search. Gives up
+// once a solution no longer than the window is known, since the lower
+// windows are searched by other threads anyway.
+template <typename State>
+bool windowSearch(State& node, std::vector<Step>& moves, int g, int window, const std::atomic<int>& best,
+                  long long& expanded, const PerimeterDatabase* perimeter) {
+    int f = g + node.estimate();
+
+    if (perimeter) {
+        int d = perimeter->distance(node);
+
+        if (d >= 0) {
+            if (g + d > window) {
+                return false;
+            }
+
+            for (Step s : perimeter->descend(node)) {
+                node.makeStep(s);
+                moves.push_back(s);
+            }
+
+            return true;
+        }
+
+        f = std::max(f, g + perimeter->getRadius() + 1);
+    }
+
+    if (f > window) {
+        return false;
+    }
+
+    if (node.isGoal()) {
+        return true;
+    }
+
+    if (window >= best.load(std::memory_order_relaxed)) {
+        return false;
+    }
+
+    countExpansion(expanded);
+
+    std::vector<std::pair<int, Step>> children;
+    Step back = moves.empty() ? start : reverse(moves.back());
+
+    for (Step s : steps) {
+        if (s != back && node.canStep(s)) {
+            children.push_back(std::make_pair(node.stepDelta(s), s));
+        }
+    }
+
+    std::sort(children.begin(), children.end());
+
+    for (std::pair<int, Step> child : children) {
+        node.makeStep(child.second);
+        moves.push_back(child.second);
+
+        if (windowSearch(node, moves, g + 1, window, best, expanded, perimeter)) {
+            return true;
+        }
+
+        moves.pop_back();
+        node.unmakeStep(child.second);
+    }
+
+    return false;
+}
+
+// Parallel window search: instead of splitting one IDA* iteration, every
+// thread runs a whole iteration with its own threshold (h, h + 2, h + 4 ...,
+// since f keeps its parity along a path). The first solution found is
+// reported at once; it is returned as optimal when every lower window has
+// finished without a shorter one.
+template <typename State>
+std::pair<std::vector<State>, int> parallelWindowStar(State root, int threads,
+                                                      const PerimeterDatabase* perimeter = nullptr) {
+    if (debugOutput) {
+        std::cout << "Starting!" << std::endl;
+    }
+    std::vector<State> path;
+
+    if (!root.isSolvable()) {
+        return std::pair<std::vector<State>, int> (path, -1);
+    }
+
+    if (debugOutput) {
+        root.print();
+    }
+
+    int base = root.estimate();
+    std::atomic<int> next(0);
+    std::atomic<int> best(INT_MAX);
+    std::atomic<bool> timedOut(false);
+    std::vector<Step> solution;
+    std::mutex solutionLock;
+    std::vector<long long> expanded(threads, 0);
+    std::vector<std::thread> workers;
+    std::chrono::steady_clock::time_point deadline = searchDeadline;
+    auto begin = std::chrono::steady_clock::now();
+
+    for (int w = 0; w < threads; w++) {
+        workers.push_back(std::thread([&, w]() {
+            searchDeadline = deadline;
+
+            try {
+                for (;;) {
+                    int window = base + 2 * next.fetch_add(1);
+
+                    if (window >= best.load() || timedOut.load()) {
+                        break;
+                    }
+
+                    if (debugOutput) {
+                        fprintf(stderr, "Searching with window %d\n", window);
+                    }
+
+                    State node = root;
+                    std::vector<Step> moves;
+
+                    if (!windowSearch(node, moves, 0, window, best, expanded[w], perimeter)) {
+                        continue;
+                    }
+
+                    std::lock_guard<std::mutex> guard(solutionLock);
+
+                    if ((int) moves.size() < best.load()) {
+                        if (debugOutput && best.load() == INT_MAX) {
+                            fprintf(stderr, "First solution: %zu moves after %lld us\n", moves.size(),
+                                    (long long) std::chrono::duration_cast<std::chrono::microseconds>(
+                                        std::chrono::steady_clock::now() - begin).count());
+                        }
+
+                        best.store(moves.size());
+                        solution = moves;
+                    }
+                }
+            }
+            catch (const char*) {
+                timedOut.store(true);
+                best.store(INT_MIN);
+            }
+        }));
+    }
+
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    for (int w = 0; w < threads; w++) {
+        expandedNodes += expanded[w];
+    }
+
+    if (timedOut.load()) {
+        throw "Deadline exceeded";
+    }
+
+    path.push_back(root);
+    for (Step s : solution) {
+        path.push_back(path.back().child(s));
+    }
+
+    return std::pair<std::vector<State>, int> (path, solution.size());
+}
+
+inline volatile sig_atomic_t checkpointSignal = 0;
+
+inline void requestCheckpoint(int signal) {
+    checkpointSignal = signal;
+}
+
+// Installs requestCheckpoint for SIGINT, SIGTERM and SIGUSR1 while in scope,
+// and puts the handlers it replaced back however the scope is left.
+class CheckpointSignals {
+private:
+    static const int count = 3;
+
+    int signals[count] = {SIGINT, SIGTERM, SIGUSR1};
+    void (*previous[count])(int);
+
+public:
+    CheckpointSignals() {
+        for (int k = 0; k < count; k++) {
+            previous[k] = signal(signals[k], requestCheckpoint);
+        }
+    }
+
+    CheckpointSignals(const CheckpointSignals&) = delete;
+    CheckpointSignals& operator=(const CheckpointSignals&) = delete;
+
+    ~CheckpointSignals() {
+        for (int k = 0; k < count; k++) {
+            signal(signals[k], previous[k] == SIG_ERR ? SIG_DFL : previous[k]);
+        }
+    }
+};
+
+// IDA* driven by an explicit stack instead of recursion, so the whole search
+// state is a handful of integers plus one frame per move on the path. That
+// state is written to a checkpoint file every interval seconds, on SIGUSR1,
+// and on SIGINT/SIGTERM before the search stops; a later run on the same
+// board picks it up and continues where it left off.
+template <typename State>
+class ResumableSearch {
+private:
+    struct Frame {
+        Step via;
+        int count;
+        int next;
+        Step children[4];
+    };
+
+    static const uint32_t magic = 0x4b435a4e;
+
+    State root;
+    State node;
+    std::string file;
+    int interval;
+    int limit;
+    int minExceeded;
+    long long expanded;
+    std::vector<Frame> stack;
+
+    Frame frame(Step via) {
+        Frame f;
+        std::vector<std::pair<int, Step>> children;
+        Step back = reverse(via);
+
+        for (Step s : steps) {
+            if (s != back && node.canStep(s)) {
+                children.push_back(std::make_pair(node.stepDelta(s), s));
+            }
+        }
+
+        std::sort(children.begin(), children.end());
+
+        f.via = via;
+        f.count = children.size();
+        f.next = 0;
+        for (int i = 0; i < f.count; i++) {
+            f.children[i] = children[i].second;
+        }
+
+        return f;
+    }
+
+    std::vector<int> rootCells() const {
+        std::vector<int> cells;
+        int side = root.getSide();
+
+        for (int i = 0; i < side; i++) {
+            for (int j = 0; j < side; j++) {
+                cells.push_back(root.at(i, j));
+            }
+        }
+
+        return cells;
+    }
+
+    void save() const {
+        std::string temporary = file + ".tmp";
+        FILE* out = fopen(temporary.c_str(), "wb");
+
+        if (!out) {
+            throw "Cannot write checkpoint";
+        }
+
+        int32_t header[5] = {(int32_t) magic, root.getSide(), root.getPos0(), limit, minExceeded};
+        std::vector<int> cells = rootCells();
+        uint64_t frames = stack.size();
+
+        fwrite(header, sizeof(header), 1, out);
+        fwrite(cells.data(), sizeof(int), cells.size(), out);
+        fwrite(&expanded, sizeof(expanded), 1, out);
+        fwrite(&frames, sizeof(frames), 1, out);
+        fwrite(stack.data(), sizeof(Frame), stack.size(), out);
+
+        bool written = fflush(out) == 0 && fsync(fileno(out)) == 0;
+        fclose(out);
+
+        if (!written || rename(temporary.c_str(), file.c_str()) != 0) {
+            throw "Cannot write checkpoint";
+        }
+
+        fprintf(stderr, "Checkpoint: limit %d, depth %zu, expanded %lld\n", limit, stack.size(), expanded);
+    }
+
+    // Restores the stack from the checkpoint file if it belongs to this board.
+    bool load() {
+        FILE* in = file.empty() ? nullptr : fopen(file.c_str(), "rb");
+
+        if (!in) {
+            return false;
+        }
+
+        int32_t header[5];
+        std::vector<int> cells = rootCells();
+        std::vector<int> saved(cells.size());
+        uint64_t frames = 0;
+
+        bool valid = fread(header, sizeof(header), 1, in) == 1 && header[0] == (int32_t) magic &&
+                     header[1] == root.getSide() && header[2] == root.getPos0() &&
+                     fread(saved.data(), sizeof(int), saved.size(), in) == saved.size() && saved == cells &&
+                     fread(&expanded, sizeof(expanded), 1, in) == 1 && fread(&frames, sizeof(frames), 1, in) == 1;
+
+        if (valid) {
+            stack.resize(frames);
+            valid = fread(stack.data(), sizeof(Frame), frames, in) == frames;
+        }
+
+        fclose(in);
+
+        if (!valid) {
+            stack.clear();
+            expanded = 0;
+            return false;
+        }
+
+        limit = header[3];
+        minExceeded = header[4];
+
+        for (size_t i = 1; i < stack.size(); i++) {
+            node.makeStep(stack[i].via);
+        }
+
+        fprintf(stderr, "Resumed: limit %d, depth %zu, expanded %lld\n", limit, stack.size(), expanded);
+
+        return true;
+    }
+
+public:
+    ResumableSearch(const State& otherRoot, const std::string& otherFile, int otherInterval)
+        : root(otherRoot), node(otherRoot), file(otherFile), interval(otherInterval),
+          limit(0), minExceeded(INT_MAX), expanded(0) {
+    }
+
+    // Returns the moves of a solution; throws if the search was suspended.
+    std::vector<Step> run() {
+        auto lastSave = std::chrono::steady_clock::now();
+        bool checkClock = false;
+        std::vector<Step> moves;
+
+        if (!load()) {
+            limit = root.estimate();
+            minExceeded = INT_MAX;
+            stack.push_back(frame(start));
+        }
+
+        if (root.isGoal()) {
+            return moves;
+        }
+
+        for (;;) {
+            if (debugOutput) {
+                std::cout << "Searching with limit " << limit << std::endl;
+            }
+
+            while (!stack.empty()) {
+                // The clock is read once per 4096 expansions, right after the
+                // one that completes them.
+                bool due = checkClock && std::chrono::steady_clock::now() - lastSave > std::chrono::seconds(interval);
+                checkClock = false;
+
+                if (checkpointSignal || due) {
+                    int signal = checkpointSignal;
+                    checkpointSignal = 0;
+
+                    if (!file.empty()) {
+                        save();
+                    }
+                    lastSave = std::chrono::steady_clock::now();
+
+                    if (signal == SIGINT || signal == SIGTERM) {
+                        throw "Search suspended";
+                    }
+                }
+
+                Frame& top = stack.back();
+
+                if (top.next == top.count) {
+                    Step via = top.via;
+                    stack.pop_back();
+
+                    if (!stack.empty()) {
+                        node.unmakeStep(via);
+                    }
+                    continue;
+                }
+
+                Step s = top.children[top.next++];
+                int g = stack.size();
+
+                node.makeStep(s);
+
+                int f = g + node.estimate();
+
+                if (f > limit) {
+                    minExceeded = std::min(minExceeded, f);
+                    node.unmakeStep(s);
+                    continue;
+                }
+
+                if (node.isGoal()) {
+                    for (size_t i = 1; i < stack.size(); i++) {
+                        moves.push_back(stack[i].via);
+                    }
+                    moves.push_back(s);
+
+                    if (!file.empty()) {
+                        remove(file.c_str());
+                    }
+
+                    expandedNodes += expanded;
+                    return moves;
+                }
+
+                countExpansion(expanded);
+                checkClock = interval > 0 && (expanded & 4095) == 0;
+                stack.push_back(frame(s));
+            }
+
+            limit = minExceeded;
+            minExceeded = INT_MAX;
+            node = root;
+            stack.push_back(frame(start));
+        }
+    }
+};
+
+template <typename State>
+std::pair<std::vector<State>, int> resumableIdaStar(State root, const std::string& checkpoint, int interval) {
+    std::vector<State> path;
+
+    if (!root.isSolvable()) {
+        return std::pair<std::vector<State>, int> (path, -1);
+    }
+
+    std::vector<Step> moves;
+
+    {
+        CheckpointSignals handlers;
+        ResumableSearch<State> search(root, checkpoint, interval);
+        moves = search.run();
+    }
+
+    path.push_back(root);
+    for (Step s : moves) {
+        path.push_back(path.back().child(s));
+    }
+
+    return std::pair<std::vector<State>, int> (path, moves.size());
+}
+
+// IDA*_CR (Sarkar et al.): instead of raising the threshold to the smallest
+// f that exceeded it, every pruned f goes into a histogram and the next
+// threshold is the smallest f whose pruned nodes, added to the last
+// iteration's, grow the tree by the given factor. A threshold can then
+// overshoot the optimal cost, so once a solution is found the rest of that
+// iteration runs as branch and bound: the limit drops below the best cost
+// found so far. No solution exists below the previous threshold, so the best
+// one when the iteration ends is optimal.
+template <typename State>
+class ControlledSearch {
+private:
+    State node;
+    int limit;
+    int bestCost;
+    long long expanded;
+    std::vector<Step> moves;
+    std::vector<Step> best;
+    std::vector<long long> exceeded;
+
+    void search(int g, Step via) {
+        countExpansion(expanded);
+
+        if (node.isGoal()) {
+            if (g < bestCost) {
+                bestCost = g;
+                best = moves;
+                limit = g - 1;
+            }
+
+            return;
+        }
+
+        Step back = reverse(via);
+        int h = node.estimate();
+
+        for (Step s : steps) {
+            if (s == back || !node.canStep(s)) {
+                continue;
+            }
+
+            int childAdditive;
+            int delta = node.stepDelta(s, childAdditive);
+            int f = g + 1 + h + delta;
+
+            if (f > limit) {
+                if (f >= (int) exceeded.size()) {
+                    exceeded.resize(f + 1, 0);
+                }
+
+                exceeded[f]++;
+                continue;
+            }
+
+            node.makeStep(s, delta, childAdditive);
+            moves.push_back(s);
+            search(g + 1, s);
+            moves.pop_back();
+            node.unmakeStep(s);
+        }
+    }
+
+public:
+    ControlledSearch(const State& root) : node(root), limit(0), bestCost(INT_MAX), expanded(0) {
+    }
+
+    std::vector<Step> run(double growth) {
+        limit = node.estimate();
+
+        while (bestCost == INT_MAX) {
+            long long before = expanded;
+            int threshold = limit;
+
+            exceeded.clear();
+            search(0, start);
+
+            if (bestCost != INT_MAX) {
+                break;
+            }
+
+            long long nodes = expanded - before;
+            long long wanted = (long long) ((growth - 1) * nodes);
+            long long pruned = 0;
+
+            limit = INT_MAX;
+
+            for (int f = threshold + 1; f < (int) exceeded.size(); f++) {
+                if (exceeded[f] == 0) {
+                    continue;
+                }
+
+                limit = f;
+                pruned += exceeded[f];
+
+                if (pruned >= wanted) {
+                    break;
+                }
+            }
+
+            if (debugOutput) {
+                std::cout << "Threshold " << threshold << ": " << nodes << " nodes, next " << limit << std::endl;
+            }
+
+            if (limit == INT_MAX) {
+                throw "Search space exhausted";
+            }
+        }
+
+        expandedNodes += expanded;
+
+        return best;
+    }
+};
+
+template <typename State>
+std::pair<std::vector<State>, int> controlledIdaStar(State root, double growth) {
+    std::vector<State> path;
+
+    if (!root.isSolvable()) {
+        return std::pair<std::vector<State>, int> (path, -1);
+    }
+
+    path.push_back(root);
+
+    if (root.isGoal()) {
+        return std::pair<std::vector<State>, int> (path, 0);
+    }
+
+    ControlledSearch<State> search(root);
+    std::vector<Step> moves = search.run(growth);
+
+    for (Step s : moves) {
+        path.push_back(path.back().child(s));
+    }
+
+    return std::pair<std::vector<State>, int> (path, moves.size());
+}
+
+#endif
@@ -0,0 +1,577 @@
+#ifndef N_PUZZLE_SERVICE_H
+#define N_PUZZLE_SERVICE_H
+
+#include "solver.h"
+
+#include <condition_variable>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+// Bounded multi-producer multi-consumer queue without locks: every cell
+// carries a sequence number telling producers and consumers whose turn it is
+// (D. Vyukov's design). Capacity is rounded up to a power of two. push and
+// pop block on a condition variable while the queue is full or empty; the
+// lock is only taken to wait and to wake waiters.
+template <typename T>
+class BoundedQueue {
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    std::unique_ptr<Cell[]> cells;
+    size_t mask;
+    alignas(64) std::atomic<size_t> head;
+    alignas(64) std::atomic<size_t> tail;
+    std::mutex waitLock;
+    std::condition_variable notEmpty;
+    std::condition_variable notFull;
+
+    // Taking the lock orders the wakeup after a waiter's last failed try, so
+    // it cannot be lost between that try and the wait.
+    void wake(std::condition_variable& waiters) {
+        {
+            std::lock_guard<std::mutex> guard(waitLock);
+        }
+
+        waiters.notify_one();
+    }
+
+public:
+    explicit BoundedQueue(size_t capacity) : head(0), tail(0) {
+        size_t size = 1;
+        while (size < capacity) {
+            size <<= 1;
+        }
+
+        cells.reset(new Cell[size]);
+        mask = size - 1;
+
+        for (size_t i = 0; i < size; i++) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    bool tryPush(T& value) {
+        size_t position = tail.load(std::memory_order_relaxed);
+
+        for (;;) {
+            Cell& cell = cells[position & mask];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            long difference = (long) sequence - (long) position;
+
+            if (difference == 0) {
+                if (tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    cell.value = std::move(value);
+                    cell.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (difference < 0) {
+                return false;
+            }
+            else {
+                position = tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool tryPop(T& value) {
+        size_t position = head.load(std::memory_order_relaxed);
+
+        for (;;) {
+            Cell& cell = cells[position & mask];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            long difference = (long) sequence - (long) (position + 1);
+
+            if (difference == 0) {
+                if (head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    value = std::move(cell.value);
+                    cell.sequence.store(position + mask + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (difference < 0) {
+                return false;
+            }
+            else {
+                position = head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void push(T value) {
+        if (!tryPush(value)) {
+            std::unique_lock<std::mutex> lock(waitLock);
+            notFull.wait(lock, [&]() { return tryPush(value); });
+        }
+
+        wake(notEmpty);
+    }
+
+    void pop(T& value) {
+        if (!tryPop(value)) {
+            std::unique_lock<std::mutex> lock(waitLock);
+            notEmpty.wait(lock, [&]() { return tryPop(value); });
+        }
+
+        wake(notFull);
+    }
+};
+
+// Batch mode: a parser thread feeds boards to a pool of solver threads, and
+// the calling thread writes the solutions back in input order. The parser
+// never runs more than queueSize boards ahead of the writer, which bounds
+// the jobs and the reorder buffer whatever the length of the input. Every
+// thread blocks rather than spins while it waits. An input error stops the
+// parser after the boards before it are written; an error in a solver
+// stops everything. Either is rethrown here once the threads are joined.
+inline void runPipeline(const Options& options, InstanceReader& reader, SolutionCache* cache) {
+    struct Job {
+        long long index;
+        Instance instance;
+    };
+
+    struct Result {
+        long long index;
+        bool failed;
+        Instance instance;
+        SolutionCache::Entry entry;
+    };
+
+    BoundedQueue<Job> jobs(options.queueSize);
+    BoundedQueue<Result> results(options.queueSize + 1);
+    long long written = 0;
+    std::atomic<bool> failed(false);
+    std::exception_ptr error;
+    std::mutex progressLock;
+    std::condition_variable progress;
+
+    // Keeps the first error and, for a solver's, stops the other threads.
+    auto fail = [&](std::exception_ptr exception, bool stop) {
+        std::lock_guard<std::mutex> guard(progressLock);
+
+        if (!error) {
+            error = exception;
+        }
+        if (stop) {
+            failed.store(true);
+        }
+
+        progress.notify_all();
+    };
+
+    long long total = 0;
+
+    std::thread parser([&]() {
+        Job job;
+
+        try {
+            while (!failed.load() && reader.next(job.instance)) {
+                {
+                    std::unique_lock<std::mutex> lock(progressLock);
+                    progress.wait(lock, [&]() { return failed.load() || total - written < options.queueSize; });
+                }
+
+                job.index = total++;
+                jobs.push(std::move(job));
+            }
+        }
+        catch (...) {
+            fail(std::current_exception(), false);
+        }
+
+        for (int w = 0; w < options.workers; w++) {
+            job.index = -1;
+            jobs.push(std::move(job));
+        }
+
+        Result done;
+        done.index = -1;
+        results.push(std::move(done));
+    });
+
+    std::vector<std::thread> solvers;
+
+    for (int w = 0; w < options.workers; w++) {
+        solvers.push_back(std::thread([&]() {
+            Job job;
+
+            for (;;) {
+                jobs.pop(job);
+
+                if (job.index < 0) {
+                    break;
+                }
+
+                Result result;
+                result.index = job.index;
+                result.failed = failed.load();
+
+                if (!result.failed) {
+                    try {
+                        checkPuzzleSide(job.instance);
+                        Puzzle p(job.instance.cells, job.instance.side, job.instance.pos0);
+                        result.entry = solveInstance(options, p, cache);
+                    }
+                    catch (...) {
+                        fail(std::current_exception(), true);
+                        result.failed = true;
+                    }
+                }
+
+                result.instance = std::move(job.instance);
+                results.push(std::move(result));
+            }
+        }));
+    }
+
+    std::unordered_map<long long, Result> pending;
+    long long received = 0;
+    bool parsed = false;
+    Result result;
+
+    // Every job sends back one result, and the parser one more after the
+    // last job, when total is final.
+    while (!parsed || received < total) {
+        results.pop(result);
+
+        if (result.index < 0) {
+            parsed = true;
+            continue;
+        }
+
+        received++;
+
+        long long index = result.index;
+        pending[index] = std::move(result);
+
+        for (auto it = pending.find(written); it != pending.end() && !failed.load(); it = pending.find(written)) {
+            const Instance& instance = it->second.instance;
+            Puzzle p(instance.cells, instance.side, instance.pos0);
+            writeSolution(std::cout, options.output, p, it->second.entry.length, it->second.entry.moves);
+            pending.erase(it);
+
+            std::lock_guard<std::mutex> guard(progressLock);
+            written++;
+            progress.notify_all();
+        }
+    }
+
+    parser.join();
+    for (std::thread& solver : solvers) {
+        solver.join();
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+inline bool readFully(int fd, void* data, size_t size) {
+    char* bytes = static_cast<char*>(data);
+
+    while (size > 0) {
+        ssize_t got = ::read(fd, bytes, size);
+
+        if (got <= 0) {
+            return false;
+        }
+
+        bytes += got;
+        size -= got;
+    }
+
+    return true;
+}
+
+inline bool writeFully(int fd, const void* data, size_t size) {
+    const char* bytes = static_cast<const char*>(data);
+
+    while (size > 0) {
+        ssize_t sent = ::write(fd, bytes, size);
+
+        if (sent <= 0) {
+            return false;
+        }
+
+        bytes += sent;
+        size -= sent;
+    }
+
+    return true;
+}
+
+// Messages on the daemon socket are a 32-bit little-endian length followed
+// by that many bytes.
+inline bool readMessage(int fd, std::string& message) {
+    uint32_t size;
+
+    if (!readFully(fd, &size, sizeof(size)) || size > (64u << 20)) {
+        return false;
+    }
+
+    message.resize(size);
+    return size == 0 || readFully(fd, &message[0], size);
+}
+
+inline bool writeMessage(int fd, const std::string& message) {
+    uint32_t size = message.size();
+    return writeFully(fd, &size, sizeof(size)) && writeFully(fd, message.data(), message.size());
+}
+
+inline sockaddr_un socketAddress(const std::string& path) {
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+
+    if (path.size() >= sizeof(address.sun_path)) {
+        throw "Socket path too long";
+    }
+
+    strcpy(address.sun_path, path.c_str());
+
+    return address;
+}
+
+// Long-lived solver: tables and caches are built once and shared by every
+// request. A request is "SOLVE <deadline ms>\n" followed by a board in the
+// input format (a deadline of 0 means none), or "STATS\n". The calling
+// thread polls the idle connections; one with a request waiting is queued to
+// a pool of worker threads, which read that one request, reply and hand the
+// connection back, so idle connections hold no worker. A connection has at
+// most one request in flight, which keeps its replies in order.
+class SolverDaemon {
+private:
+    const Options& options;
+    SolutionCache* cache;
+    std::chrono::steady_clock::time_point started;
+    std::atomic<long long> requests;
+    std::atomic<long long> solved;
+    std::atomic<long long> timeouts;
+    std::atomic<long long> errors;
+    std::atomic<long long> busyMicroseconds;
+
+    std::string stats() const {
+        std::ostringstream out;
+
+        out << "uptime_ms " << std::chrono::duration_cast<std::chrono::milliseconds>(
+                                   std::chrono::steady_clock::now() - started).count() << '\n'
+            << "requests " << requests.load() << '\n'
+            << "solved " << solved.load() << '\n'
+            << "timeouts " << timeouts.load() << '\n'
+            << "errors " << errors.load() << '\n'
+            << "busy_us " << busyMicroseconds.load() << '\n';
+
+        return out.str();
+    }
+
+    std::string handle(const std::string& request) {
+        size_t lineEnd = std::min(request.find('\n'), request.size());
+        std::istringstream header(request.substr(0, lineEnd));
+        std::string command;
+        long long deadlineMs = 0;
+
+        header >> command >> deadlineMs;
+
+        if (command == "STATS") {
+            return stats();
+        }
+
+        requests++;
+
+        if (command != "SOLVE") {
+            errors++;
+            return "ERROR Unknown command\n";
+        }
+
+        auto begin = std::chrono::steady_clock::now();
+        size_t body = std::min(lineEnd + 1, request.size());
+        std::ostringstream out;
+
+        searchDeadline = deadlineMs > 0 ? begin + std::chrono::milliseconds(deadlineMs)
+                                        : std::chrono::steady_clock::time_point::max();
+
+        try {
+            InstanceReader reader(request.data() + body, request.size() - body);
+            Instance instance;
+
+            if (!reader.next(instance)) {
+                throw "Missing board";
+            }
+
+            checkPuzzleSide(instance);
+            Puzzle p(instance.cells, instance.side, instance.pos0);
+            SolutionCache::Entry entry = solveInstance(options, p, cache);
+            writeSolution(out, "moves", p, entry.length, entry.moves);
+            solved++;
+        }
+        catch (const char* message) {
+            std::string reason = message;
+
+            if (reason == "Deadline exceeded") {
+                timeouts++;
+            }
+            else {
+                errors++;
+            }
+
+            out.str("ERROR " + reason + "\n");
+        }
+        catch (const std::exception& exception) {
+            errors++;
+            out.str(std::string("ERROR ") + exception.what() + "\n");
+        }
+
+        searchDeadline = std::chrono::steady_clock::time_point::max();
+        busyMicroseconds += std::chrono::duration_cast<std::chrono::microseconds>(
+                                std::chrono::steady_clock::now() - begin).count();
+
+        return out.str();
+    }
+
+public:
+    SolverDaemon(const Options& otherOptions, SolutionCache* otherCache)
+        : options(otherOptions), cache(otherCache), started(std::chrono::steady_clock::now()),
+          requests(0), solved(0), timeouts(0), errors(0), busyMicroseconds(0) {
+    }
+
+    void run(const std::string& path) {
+        sockaddr_un address = socketAddress(path);
+        unlink(path.c_str());
+
+        int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+
+        if (listener < 0 || bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+            listen(listener, 128) != 0) {
+            throw "Cannot listen on daemon socket";
+        }
+
+        signal(SIGPIPE, SIG_IGN);
+
+        int workers = options.workers > 0 ? options.workers : options.threads;
+        BoundedQueue<int> ready(options.queueSize);
+        std::vector<std::thread> pool;
+        std::mutex returnedLock;
+        std::vector<int> returned;
+        int wake[2];
+
+        if (pipe(wake) != 0 || fcntl(wake[1], F_SETFL, O_NONBLOCK) != 0) {
+            throw "Cannot create daemon wakeup pipe";
+        }
+
+        for (int w = 0; w < workers; w++) {
+            pool.push_back(std::thread([&]() {
+                std::string request;
+                int fd;
+
+                for (;;) {
+                    ready.pop(fd);
+
+                    if (!readMessage(fd, request) || !writeMessage(fd, handle(request))) {
+                        close(fd);
+                        continue;
+                    }
+
+                    {
+                        std::lock_guard<std::mutex> guard(returnedLock);
+                        returned.push_back(fd);
+                    }
+
+                    // A write that fails on a full pipe is fine: a wakeup is
+                    // already pending.
+                    char byte = 0;
+                    ssize_t written = write(wake[1], &byte, 1);
+                    (void) written;
+                }
+            }));
+        }
+
+        std::vector<int> idle;
+        std::vector<pollfd> watched;
+
+        for (;;) {
+            watched.assign({{listener, POLLIN, 0}, {wake[0], POLLIN, 0}});
+
+            for (int fd : idle) {
+                watched.push_back({fd, POLLIN, 0});
+            }
+
+            if (poll(watched.data(), watched.size(), -1) < 0) {
+                continue;
+            }
+
+            if (watched[1].revents & POLLIN) {
+                char bytes[256];
+
+                if (read(wake[0], bytes, sizeof(bytes)) > 0) {
+                    std::lock_guard<std::mutex> guard(returnedLock);
+                    idle.insert(idle.end(), returned.begin(), returned.end());
+                    returned.clear();
+                }
+            }
+
+            for (size_t k = 2; k < watched.size(); k++) {
+                if (watched[k].revents) {
+                    idle.erase(std::find(idle.begin(), idle.end(), watched[k].fd));
+                    ready.push(watched[k].fd);
+                }
+            }
+
+            if (watched[0].revents & POLLIN) {
+                int fd = accept(listener, nullptr, nullptr);
+
+                if (fd >= 0) {
+                    idle.push_back(fd);
+                }
+            }
+        }
+    }
+};
+
+// Command-line client for the daemon: sends every board of the input as a
+// SOLVE request and prints the replies, or prints the daemon's STATS.
+inline void runClient(const Options& options) {
+    sockaddr_un address = socketAddress(options.connect);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        throw "Cannot connect to solver daemon";
+    }
+
+    std::string reply;
+
+    if (options.stats) {
+        if (writeMessage(fd, "STATS\n") && readMessage(fd, reply)) {
+            std::cout << reply;
+        }
+
+        close(fd);
+        return;
+    }
+
+    InstanceReader reader(options.input);
+    Instance instance;
+
+    while (reader.next(instance)) {
+        std::ostringstream request;
+        request << "SOLVE " << options.deadlineMs << '\n'
+                << instance.side * instance.side - 1 << '\n' << instance.pos0 << '\n';
+
+        for (int value : instance.cells) {
+            request << value << ' ';
+        }
+
+        if (!writeMessage(fd, request.str()) || !readMessage(fd, reply)) {
+            close(fd);
+            throw "Lost connection to solver daemon";
+        }
+
+        std::cout << reply;
+    }
+
+    close(fd);
+}
+
+#endif
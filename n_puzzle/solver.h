@@ -0,0 +1,644 @@
+#ifndef N_PUZZLE_SOLVER_H
+#define N_PUZZLE_SOLVER_H
+
+#include "search.h"
+#include "instances.h"
+#include "options.h"
+#include "hierarchy.h"
+#include "optimize.h"
+#include "macro.h"
+
+// Perimeter databases are built once per (side, pos0, radius) and then
+// shared by every solve in the process.
+inline const PerimeterDatabase* perimeterFor(int side, int pos0, int radius) {
+    static std::mutex lock;
+    static std::map<std::tuple<int, int, int>, std::unique_ptr<PerimeterDatabase>> databases;
+
+    std::lock_guard<std::mutex> guard(lock);
+    std::unique_ptr<PerimeterDatabase>& database = databases[std::make_tuple(side, pos0, radius)];
+
+    if (!database) {
+        database.reset(new PerimeterDatabase(side, pos0, radius));
+        fprintf(stderr, "Perimeter database: %zu states within %d moves\n", database->size(), radius);
+    }
+
+    return database.get();
+}
+
+// Runtime model for IDA* after Korf, Reid and Edelkamp: an iteration with
+// threshold T expands about sum_i N_i P(T - i) nodes, where N_i is the number
+// of nodes at depth i of the brute-force tree and P(v) the fraction of states
+// with heuristic at most v. N_i follows exactly from the blank's cell, since
+// that alone decides how many moves a node has; P comes from sampling
+// uniform random boards.
+class CostModel {
+private:
+    int side;
+    std::vector<double> heuristicCdf;
+
+public:
+    CostModel(int otherSide, int pos0, int samples, unsigned long long seed) : side(otherSide) {
+        InstanceGenerator generator(side, pos0, 0, 0, INT_MAX, seed);
+        std::vector<double> histogram;
+        Instance instance;
+
+        for (int k = 0; k < samples; k++) {
+            generator.next(instance);
+            int h = Puzzle(instance.cells, side, pos0).estimate();
+
+            if (h >= (int) histogram.size()) {
+                histogram.resize(h + 1, 0);
+            }
+
+            histogram[h] += 1.0 / samples;
+        }
+
+        heuristicCdf.assign(histogram.size(), 0);
+
+        for (size_t v = 0; v < histogram.size(); v++) {
+            heuristicCdf[v] = (v > 0 ? heuristicCdf[v - 1] : 0) + histogram[v];
+        }
+    }
+
+    double cdf(int v) const {
+        return v < 0 ? 0 : (v < (int) heuristicCdf.size() ? heuristicCdf[v] : 1);
+    }
+
+    // Predicted expansions of one iteration from a root with the blank in
+    // the given cell.
+    double iterationNodes(int blankCell, int threshold) const {
+        int cells = side * side;
+        std::vector<double> counts(cells, 0), next(cells);
+        double nodes = 0;
+        counts[blankCell] = 1;
+
+        for (int depth = 0; depth <= threshold; depth++) {
+            double atDepth = 0;
+
+            for (double count : counts) {
+                atDepth += count;
+            }
+
+            nodes += atDepth * cdf(threshold - depth);
+
+            std::fill(next.begin(), next.end(), 0);
+
+            for (int cell = 0; cell < cells; cell++) {
+                if (counts[cell] == 0) {
+                    continue;
+                }
+                if (cell >= side) {
+                    next[cell - side] += counts[cell];
+                }
+                if (cell + side < cells) {
+                    next[cell + side] += counts[cell];
+                }
+                if (cell % side > 0) {
+                    next[cell - 1] += counts[cell];
+                }
+                if (cell % side < side - 1) {
+                    next[cell + 1] += counts[cell];
+                }
+            }
+
+            counts.swap(next);
+        }
+
+        return nodes;
+    }
+
+    // Predicted expansions of every iteration from h0 up to depth (f keeps
+    // its parity, so thresholds go up by two).
+    double totalNodes(int blankCell, int h0, int depth) const {
+        double nodes = 0;
+
+        for (int threshold = h0; threshold <= depth; threshold += 2) {
+            nodes += iterationNodes(blankCell, threshold);
+        }
+
+        return nodes;
+    }
+};
+
+// Cost models are sampled once per (side, pos0) and shared like perimeters.
+inline const CostModel* costModelFor(int side, int pos0) {
+    static std::mutex lock;
+    static std::map<std::pair<int, int>, std::unique_ptr<CostModel>> models;
+
+    std::lock_guard<std::mutex> guard(lock);
+    std::unique_ptr<CostModel>& model = models[std::make_pair(side, pos0)];
+
+    if (!model) {
+        model.reset(new CostModel(side, pos0, 10000, 1));
+    }
+
+    return model.get();
+}
+
+// Automatic engine selection. A perimeter hit is answered from the table;
+// otherwise IDA* probes the instance for 10 ms, which solves easy ones
+// outright. The expansions of the last finished iteration calibrate the cost
+// model, whose prediction for the next iteration picks A* (EPEA*) when the
+// rest is small enough to keep in memory, IDA* in the middle and parallel
+// IDA* beyond. Predicted against actual cost is logged on stderr.
+inline std::pair<std::vector<Puzzle>, int> autoSolve(const Options& options, Puzzle root,
+                                                     const PerimeterDatabase* perimeter) {
+    std::vector<Puzzle> path(1, root);
+
+    if (!root.isSolvable()) {
+        return std::pair<std::vector<Puzzle>, int> (std::vector<Puzzle>(), -1);
+    }
+
+    if (perimeter && perimeter->distance(root) >= 0) {
+        for (Step s : perimeter->descend(root)) {
+            path.push_back(path.back().child(s));
+        }
+
+        fprintf(stderr, "auto: table, length %zu\n", path.size() - 1);
+        return std::pair<std::vector<Puzzle>, int> (path, path.size() - 1);
+    }
+
+    const CostModel* model = costModelFor(root.getSide(), root.getPos0());
+    int h0 = root.estimate();
+    int blankCell = 0;
+
+    for (int cell = 0; cell < root.getSide() * root.getSide(); cell++) {
+        if (root.at(cell / root.getSide(), cell % root.getSide()) == 0) {
+            blankCell = cell;
+        }
+    }
+
+    std::chrono::steady_clock::time_point deadline = searchDeadline;
+    searchDeadline = std::min(deadline, std::chrono::steady_clock::now() + std::chrono::milliseconds(10));
+    long long start = expandedNodes;
+
+    int limit = h0, lastLimit = -1;
+    long long lastNodes = 0;
+    bool solved = root.isGoal();
+
+    try {
+        while (!solved) {
+            long long before = expandedNodes;
+            int next = aStar(path, 0, limit, perimeter);
+
+            if (next == 0) {
+                solved = true;
+            }
+            else {
+                lastLimit = limit;
+                lastNodes = expandedNodes - before;
+                limit = next;
+            }
+        }
+    }
+    catch (const char* message) {
+        if (std::string(message) != "Deadline exceeded") {
+            throw;
+        }
+
+        path.assign(1, root);
+    }
+
+    searchDeadline = deadline;
+
+    if (std::chrono::steady_clock::now() > deadline) {
+        throw "Deadline exceeded";
+    }
+
+    long long probeNodes = expandedNodes - start;
+    double calibration = lastLimit >= 0 ? std::max(1LL, lastNodes) / model->iterationNodes(blankCell, lastLimit) : 1;
+    double predicted = calibration * model->iterationNodes(blankCell, limit);
+    std::string engine = "probe";
+    std::pair<std::vector<Puzzle>, int> result(path, path.size() - 1);
+
+    if (!solved) {
+        Options chosen(options);
+        chosen.engine = predicted < 2e5 ? "epea" : (predicted < 5e7 ? "ida" : "parallel");
+        engine = chosen.engine;
+
+        if (engine == "epea") {
+            result = epeaStar(root);
+        }
+        else if (engine == "ida") {
+            result = idaStar(root, perimeter);
+        }
+        else {
+            result = parallelIdaStar(root, options.threads, options.tableBits, perimeter);
+        }
+    }
+
+    fprintf(stderr, "auto: %s, h %d, probe %lld nodes to threshold %d, predicted %.0f for threshold %d; "
+                    "length %d, expanded %lld, model %.0f for that length\n",
+            engine.c_str(), h0, probeNodes, lastLimit, predicted, limit, result.second, expandedNodes - start,
+            calibration * model->totalNodes(blankCell, h0, result.second));
+
+    return result;
+}
+
+// IDA* on flat boards with the hierarchical abstraction heuristic, whose
+// cache warms up over a batch. The path is replayed on the default puzzle.
+inline std::pair<std::vector<Puzzle>, int> hierarchicalIdaStar(Puzzle root) {
+    typedef BasicPuzzle<FlatBoard, HierarchicalHeuristic> State;
+    std::pair<std::vector<State>, int> result = idaStar(State(root.cells(), root.getSide(), root.getPos0()));
+    std::vector<Puzzle> path;
+
+    if (result.second >= 0) {
+        path.push_back(root);
+
+        for (size_t i = 1; i < result.first.size(); i++) {
+            path.push_back(path.back().child(result.first[i - 1].stepTo(result.first[i])));
+        }
+    }
+
+    Abstraction& abstraction = abstractionFor(root.getSide(), root.getPos0());
+    AbstractionCache::Stats stats = abstractionCache().getStats();
+
+    fprintf(stderr, "Abstractions: %lld searches expanding %lld states; cache %lld lookups, %lld hits, "
+                    "%lld stored, %lld evicted, %lld spilled, %lld loaded\n",
+            abstraction.getSearches(), abstraction.getExpanded(), stats.lookups, stats.hits, stats.stores,
+            stats.evictions, stats.spilled, stats.loaded);
+
+    return std::pair<std::vector<Puzzle>, int> (path, result.second);
+}
+
+inline std::pair<std::vector<Puzzle>, int> solve(const Options& options, Puzzle root) {
+    const PerimeterDatabase* perimeter = nullptr;
+
+    if (options.perimeter > 0 && (options.engine == "ida" || options.engine == "parallel" || options.engine == "window" ||
+                                  options.engine == "auto")) {
+        perimeter = perimeterFor(root.getSide(), root.getPos0(), options.perimeter);
+    }
+
+    if (options.engine == "auto") {
+        return autoSolve(options, root, perimeter);
+    }
+
+    if (options.engine == "epea") {
+        return epeaStar(root);
+    }
+    if (options.engine == "rbfs") {
+        return rbfsStar(root);
+    }
+    if (options.engine == "parallel") {
+        return parallelIdaStar(root, options.threads, options.tableBits, perimeter);
+    }
+    if (options.engine == "window") {
+        return parallelWindowStar(root, options.threads, perimeter);
+    }
+    if (options.engine == "resumable") {
+        return resumableIdaStar(root, options.checkpoint, options.checkpointInterval);
+    }
+    if (options.engine == "cr") {
+        return controlledIdaStar(root, options.growth);
+    }
+    if (options.engine == "hida") {
+        return hierarchicalIdaStar(root);
+    }
+    if (options.engine == "ida") {
+        return idaStar(root, perimeter);
+    }
+
+    throw "Unknown engine";
+}
+
+template <typename State>
+std::string movesOf(const std::vector<State>& path) {
+    std::string moves;
+
+    for (size_t i = 1; i < path.size(); i++) {
+        moves += stepLetter(path[i - 1].stepTo(path[i]));
+    }
+
+    return moves;
+}
+
+// Writes one solution. "moves" prints the length and the U/D/L/R string,
+// "binary" a 32-bit length followed by the moves packed four to a byte, and
+// "boards" every board on the path (for debugging).
+inline void writeSolution(std::ostream& out, const std::string& format, Puzzle p, int length, const std::string& moves) {
+    if (format == "binary") {
+        int32_t packedLength = length;
+        std::vector<char> packed((moves.size() + 3) / 4, 0);
+
+        for (size_t i = 0; i < moves.size(); i++) {
+            packed[i / 4] |= (letterStep(moves[i]) - 1) << (2 * (i % 4));
+        }
+
+        out.write(reinterpret_cast<const char*>(&packedLength), sizeof(packedLength));
+        out.write(packed.data(), packed.size());
+    }
+    else if (format == "boards") {
+        out << length << '\n';
+
+        if (length >= 0) {
+            p.print(out);
+            out << '\n';
+
+            for (char c : moves) {
+                p.makeStep(letterStep(c));
+                p.print(out);
+                out << '\n';
+            }
+        }
+    }
+    else {
+        out << length << '\n' << moves << '\n';
+    }
+}
+
+// Relabels an instance whose blank ends in cell pos0 into a canonical goal
+// frame, so that tables, perimeter databases and cache entries built for one
+// blank goal serve every goal equivalent to it. Only a symmetry of the board
+// can move the blank's goal, so the frame is the one of the eight rotations
+// and reflections that takes pos0 to the highest cell it can reach (the last
+// cell for all four corners). Tiles are renamed after their goal cells in
+// that frame, and solution moves are mapped back by the inverse symmetry.
+class GoalFrame {
+private:
+    int side;
+    int pos0;
+    int canonicalPos0;
+    int symmetry;
+    Step back[5];
+
+    // Symmetry k: an optional transpose, then optional flips. With side 1 it
+    // maps step directions instead of cells.
+    static void transform(int k, int side, int& i, int& j) {
+        if (k & 4) {
+            std::swap(i, j);
+        }
+        if (k & 1) {
+            j = side - 1 - j;
+        }
+        if (k & 2) {
+            i = side - 1 - i;
+        }
+    }
+
+    int map(int cell) const {
+        int i = cell / side, j = cell % side;
+        transform(symmetry, side, i, j);
+        return i * side + j;
+    }
+
+    // Direction a tile moves on the given step.
+    static void direction(Step s, int& di, int& dj) {
+        di = s == up ? -1 : (s == down ? 1 : 0);
+        dj = s == left ? -1 : (s == right ? 1 : 0);
+    }
+
+public:
+    GoalFrame(int otherSide, int otherPos0) : side(otherSide), pos0(otherPos0), canonicalPos0(-1), symmetry(0) {
+        for (int k = 0; k < 8; k++) {
+            int i = pos0 / side, j = pos0 % side;
+            transform(k, side, i, j);
+
+            if (i * side + j > canonicalPos0) {
+                canonicalPos0 = i * side + j;
+                symmetry = k;
+            }
+        }
+
+        back[start] = start;
+
+        for (Step s : steps) {
+            int di, dj;
+            direction(s, di, dj);
+            transform(symmetry, 1, di, dj);
+
+            for (Step t : steps) {
+                int ti, tj;
+                direction(t, ti, tj);
+
+                if (ti == di && tj == dj) {
+                    back[t] = s;
+                }
+            }
+        }
+    }
+
+    int getPos0() const {
+        return canonicalPos0;
+    }
+
+    std::vector<int> normalize(const std::vector<int>& cells) const {
+        std::vector<int> canonical(cells.size());
+
+        for (size_t c = 0; c < cells.size(); c++) {
+            int goal = map(goalCell(cells[c], pos0));
+            canonical[map(c)] = cells[c] == 0 ? 0 : (goal < canonicalPos0 ? goal + 1 : goal);
+        }
+
+        return canonical;
+    }
+
+    std::string restore(const std::string& moves) const {
+        std::string original(moves);
+
+        for (char& c : original) {
+            c = stepLetter(back[letterStep(c)]);
+        }
+
+        return original;
+    }
+};
+
+// Shortens the moves from the given board with windows of options.optimize
+// moves, within the calling thread's deadline and --deadline, and reports
+// the gain on stderr.
+inline std::string optimizeMoves(const Options& options, const std::vector<int>& cells, int side,
+                                 const std::string& moves) {
+    auto begin = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point deadline = searchDeadline;
+
+    if (options.deadlineMs > 0) {
+        deadline = std::min(deadline, begin + std::chrono::milliseconds(options.deadlineMs));
+    }
+
+    PathOptimizer optimizer(side, options.optimize, options.threads, deadline);
+    std::string shorter = optimizer.optimize(cells, moves);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    const PathOptimizer::Stats& stats = optimizer.getStats();
+
+    fprintf(stderr, "Path optimization: %zu -> %zu moves (%lld cancelled), %lld windows in %d passes, "
+                    "%lld shortened, %lld past the deadline, %.3f s\n",
+            moves.size(), shorter.size(), stats.cancelled, stats.windows, stats.passes, stats.shortened,
+            stats.pastDeadline, seconds);
+
+    return shorter;
+}
+
+// Solves in the canonical goal frame, so all tables and the cache are shared
+// by equivalent blank goals. Unsolvable boards are rejected by parity first.
+inline SolutionCache::Entry solveInstance(const Options& options, const Puzzle& p, SolutionCache* cache) {
+    SolutionCache::Entry entry = {-1, -1, ""};
+    std::vector<int> cells = p.cells();
+
+    if (!Puzzle::isSolvable(cells, p.getSide(), p.getPos0())) {
+        return entry;
+    }
+
+    GoalFrame frame(p.getSide(), p.getPos0());
+    Puzzle canonical(frame.normalize(cells), p.getSide(), frame.getPos0());
+
+    // Only the macro fallback stores solutions longer than their lower
+    // bound, and an optimal engine must not be answered with one of them.
+    bool fallback = options.engine == "auto" && p.getSide() > 5;
+
+    if (!cache || !cache->lookup(canonical, entry) || (!fallback && entry.lowerBound < entry.length)) {
+        if (fallback) {
+            // Past 5x5 no optimal engine is practical, so auto falls back to
+            // the bounded-suboptimal macro solver. The heuristic is then the
+            // only lower bound known.
+            std::ostringstream moves;
+            MacroSolver(Instance{p.getSide(), frame.getPos0(), canonical.cells()}, moves).solve();
+
+            entry.moves = moves.str();
+            entry.length = entry.moves.size();
+            entry.lowerBound = canonical.estimate();
+            fprintf(stderr, "auto: macro, h %d, length %d\n", entry.lowerBound, entry.length);
+        }
+        else {
+            std::pair<std::vector<Puzzle>, int> result = solve(options, canonical);
+
+            entry.length = result.second;
+            entry.lowerBound = result.second;
+            entry.moves = movesOf(result.first);
+        }
+
+        // Only a solution not known to be optimal can get shorter.
+        if (options.optimize > 0 && entry.lowerBound < entry.length) {
+            entry.moves = optimizeMoves(options, canonical.cells(), canonical.getSide(), entry.moves);
+            entry.length = entry.moves.size();
+        }
+
+        if (cache) {
+            cache->store(canonical, entry);
+        }
+    }
+
+    entry.moves = frame.restore(entry.moves);
+
+    return entry;
+}
+
+// Engines for Solver, each one of the sequential searches above. They work on
+// any puzzle type, so the search is compiled once per representation and
+// heuristic.
+struct IdaEngine {
+    static const char* name() {
+        return "ida";
+    }
+
+    template <typename State>
+    static std::pair<std::vector<State>, int> search(const State& root) {
+        return idaStar(root);
+    }
+};
+
+struct EpeaEngine {
+    static const char* name() {
+        return "epea";
+    }
+
+    template <typename State>
+    static std::pair<std::vector<State>, int> search(const State& root) {
+        return epeaStar(root);
+    }
+};
+
+struct RbfsEngine {
+    static const char* name() {
+        return "rbfs";
+    }
+
+    template <typename State>
+    static std::pair<std::vector<State>, int> search(const State& root) {
+        return rbfsStar(root);
+    }
+};
+
+struct ControlledEngine {
+    static const char* name() {
+        return "cr";
+    }
+
+    template <typename State>
+    static std::pair<std::vector<State>, int> search(const State& root) {
+        return controlledIdaStar(root, 2);
+    }
+};
+
+// The parallel engines and the resumable search, with fixed settings small
+// enough for any caller: two threads, a 64k-entry transposition table, and
+// no checkpoint file.
+struct ParallelEngine {
+    static const char* name() {
+        return "parallel";
+    }
+
+    template <typename State>
+    static std::pair<std::vector<State>, int> search(const State& root) {
+        return parallelIdaStar(root, 2, 16);
+    }
+};
+
+struct WindowEngine {
+    static const char* name() {
+        return "window";
+    }
+
+    template <typename State>
+    static std::pair<std::vector<State>, int> search(const State& root) {
+        return parallelWindowStar(root, 2);
+    }
+};
+
+struct ResumableEngine {
+    static const char* name() {
+        return "resumable";
+    }
+
+    template <typename State>
+    static std::pair<std::vector<State>, int> search(const State& root) {
+        return resumableIdaStar(root, "", 0);
+    }
+};
+
+struct Solution {
+    int length;
+    std::string moves;
+};
+
+// The library's solver: representation, heuristic and engine are fixed at
+// compile time. solve() takes a board with the blank's goal anywhere and
+// returns the optimal length and U/D/L/R moves, or length -1 when the board
+// is unsolvable. It throws "Deadline exceeded" like the engines do.
+template <typename Board = VectorBoard, typename Heuristic = LinearConflict, typename Engine = IdaEngine>
+class Solver {
+public:
+    typedef BasicPuzzle<Board, Heuristic> State;
+
+    static std::string name() {
+        return std::string(Board::name()) + "/" + Heuristic::name() + "/" + Engine::name();
+    }
+
+    static Solution solve(const Instance& instance) {
+        Solution solution = {-1, ""};
+
+        if (!State::isSolvable(instance.cells, instance.side, instance.pos0)) {
+            return solution;
+        }
+
+        GoalFrame frame(instance.side, instance.pos0);
+        State root(frame.normalize(instance.cells), instance.side, frame.getPos0());
+        std::pair<std::vector<State>, int> result = Engine::search(root);
+
+        solution.length = result.second;
+        solution.moves = frame.restore(movesOf(result.first));
+
+        return solution;
+    }
+};
+
+#endif
@@ -0,0 +1,951 @@
+#ifndef N_PUZZLE_TABLES_H
+#define N_PUZZLE_TABLES_H
+
+#include "puzzle.h"
+
+#include <atomic>
+#include <memory>
+#include <new>
+#include <unordered_map>
+#include <queue>
+#include <cstring>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+inline bool hugePageTables = true;
+
+// Size of the pages backing the memory at address, as the kernel reports it
+// in /proc/self/smaps: the huge page size for hugetlbfs mappings, and for
+// other mappings the PMD size once any part of it is in transparent huge
+// pages, else the base page size.
+inline size_t backingPageSize(const void* address) {
+    FILE* smaps = fopen("/proc/self/smaps", "r");
+    size_t pageSize = sysconf(_SC_PAGESIZE);
+    bool inside = false;
+    char line[256];
+
+    if (!smaps) {
+        return pageSize;
+    }
+
+    while (fgets(line, sizeof(line), smaps)) {
+        unsigned long long begin, end, kb;
+
+        if (sscanf(line, "%llx-%llx ", &begin, &end) == 2) {
+            inside = (uintptr_t) address >= begin && (uintptr_t) address < end;
+        }
+        else if (inside && sscanf(line, "KernelPageSize: %llu kB", &kb) == 1) {
+            pageSize = std::max<size_t>(pageSize, kb << 10);
+        }
+        else if (inside && (sscanf(line, "AnonHugePages: %llu kB", &kb) == 1 ||
+                            sscanf(line, "FilePmdMapped: %llu kB", &kb) == 1) && kb > 0) {
+            pageSize = std::max<size_t>(pageSize, 2 << 20);
+        }
+    }
+
+    fclose(smaps);
+
+    return pageSize;
+}
+
+// Anonymous memory for the large randomly probed tables, where 4 kB pages
+// make most probes a TLB miss. With huge set it is taken from the hugetlbfs
+// pool if the pool can hold it, else mapped 2 MB aligned and marked with
+// madvise(MADV_HUGEPAGE) for transparent huge pages, which the kernel may
+// or may not grant; getPageSize() says what was obtained once the memory
+// has been touched. The memory starts zeroed.
+class HugePageRegion {
+private:
+    static const size_t hugePage = 2 << 20;
+
+    void* mapping;
+    size_t mappedBytes;
+    char* memory;
+
+public:
+    HugePageRegion(size_t bytes, bool huge = hugePageTables) {
+        size_t rounded = (std::max<size_t>(bytes, 1) + hugePage - 1) / hugePage * hugePage;
+
+        mapping = huge ? mmap(nullptr, rounded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB,
+                              -1, 0)
+                       : MAP_FAILED;
+        mappedBytes = rounded;
+
+        if (mapping == MAP_FAILED) {
+            mappedBytes = huge ? rounded + hugePage : bytes;
+            mapping = mmap(nullptr, mappedBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+            if (mapping == MAP_FAILED) {
+                throw "Cannot allocate table memory";
+            }
+        }
+
+        memory = static_cast<char*>(mapping);
+
+        if (huge && mappedBytes > rounded) {
+            memory += (hugePage - (uintptr_t) memory % hugePage) % hugePage;
+            madvise(memory, rounded, MADV_HUGEPAGE);
+        }
+        else if (!huge) {
+            madvise(memory, mappedBytes, MADV_NOHUGEPAGE);
+        }
+    }
+
+    HugePageRegion(const HugePageRegion&) = delete;
+    HugePageRegion& operator=(const HugePageRegion&) = delete;
+
+    ~HugePageRegion() {
+        munmap(mapping, mappedBytes);
+    }
+
+    void* data() const {
+        return memory;
+    }
+
+    size_t getPageSize() const {
+        return backingPageSize(memory);
+    }
+};
+
+// Fixed-size transposition table shared by the threads of one parallel solve.
+// An entry is two atomic words, data and key ^ data; a reader accepts it only
+// if they XOR back to its key, so torn concurrent writes read as misses and no
+// lock is needed. data packs g (16 bits), the generation (16 bits) and the high
+// key bits (32 bits). Bumping the generation empties the table in O(1).
+class TranspositionTable {
+private:
+    struct Entry {
+        std::atomic<unsigned long long> check;
+        std::atomic<unsigned long long> data;
+    };
+
+    HugePageRegion memory;
+    Entry* entries;
+    unsigned long long mask;
+    std::atomic<unsigned> generation;
+
+public:
+    struct Stats {
+        long long probes = 0;
+        long long hits = 0;
+        long long collisions = 0;
+        long long stores = 0;
+
+        void add(const Stats& other) {
+            probes += other.probes;
+            hits += other.hits;
+            collisions += other.collisions;
+            stores += other.stores;
+        }
+    };
+
+    explicit TranspositionTable(int bits, bool huge = hugePageTables)
+        : memory(sizeof(Entry) << bits, huge), entries(static_cast<Entry*>(memory.data())), mask((1ULL << bits) - 1),
+          generation(1) {
+        for (unsigned long long i = 0; i <= mask; i++) {
+            new (&entries[i]) Entry;
+            entries[i].check.store(0, std::memory_order_relaxed);
+            entries[i].data.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    size_t getPageSize() const {
+        return memory.getPageSize();
+    }
+
+    void nextGeneration() {
+        unsigned next = generation.fetch_add(1) + 1;
+
+        if ((next & 0xffff) == 0) {
+            generation.fetch_add(1);
+        }
+    }
+
+    // Starts loading the entry of key into the cache, for a probe shortly
+    // after.
+    void prefetch(unsigned long long key) const {
+        __builtin_prefetch(&entries[key & mask], 1, 1);
+    }
+
+    // Returns true if the state was already reached in this generation with a
+    // g no larger than this one; otherwise records g for it.
+    bool probeAndStore(unsigned long long key, int g, Stats& stats) {
+        Entry& entry = entries[key & mask];
+        unsigned long long current = generation.load(std::memory_order_relaxed) & 0xffff;
+
+        stats.probes++;
+
+        unsigned long long data = entry.data.load(std::memory_order_relaxed);
+        unsigned long long check = entry.check.load(std::memory_order_relaxed);
+
+        if (((data >> 16) & 0xffff) == current) {
+            if ((check ^ data) == key) {
+                if ((int) (data & 0xffff) <= g) {
+                    stats.hits++;
+                    return true;
+                }
+            }
+            else {
+                stats.collisions++;
+            }
+        }
+
+        data = (key & 0xffffffff00000000ULL) | (current << 16) | (unsigned long long) g;
+        entry.check.store(key ^ data, std::memory_order_relaxed);
+        entry.data.store(data, std::memory_order_relaxed);
+        stats.stores++;
+
+        return false;
+    }
+};
+
+// Exact distances of every state within radius moves of the goal, built by a
+// breadth-first search back from it. States are keyed by their packed board
+// rather than a hash of it, so no two boards can share an entry. A state
+// outside the perimeter is at least radius + 1 moves away.
+class PerimeterDatabase {
+private:
+    int radius;
+    std::unordered_map<std::string, unsigned char> distances;
+
+    // Four bits a cell up to 4x4 (which fits the string's inline buffer),
+    // a byte a cell above.
+    template <typename State>
+    static std::string pack(const State& p) {
+        int side = p.getSide();
+        bool nibbles = side <= 4;
+        std::string packed(nibbles ? (side * side + 1) / 2 : side * side, '\0');
+
+        for (int c = 0; c < side * side; c++) {
+            int value = p.at(c / side, c % side);
+
+            if (nibbles) {
+                packed[c / 2] |= value << (4 * (c % 2));
+            }
+            else {
+                packed[c] = value;
+            }
+        }
+
+        return packed;
+    }
+
+public:
+    PerimeterDatabase(int side, int pos0, int otherRadius) : radius(otherRadius) {
+        std::vector<Puzzle> layer(1, goalPuzzle(side, pos0));
+        distances[pack(layer[0])] = 0;
+
+        for (int depth = 1; depth <= radius && !layer.empty(); depth++) {
+            std::vector<Puzzle> next;
+
+            for (Puzzle& node : layer) {
+                for (Step s : steps) {
+                    if (!node.canStep(s)) {
+                        continue;
+                    }
+
+                    node.makeStep(s);
+
+                    if (distances.emplace(pack(node), depth).second) {
+                        next.push_back(node);
+                    }
+
+                    node.unmakeStep(s);
+                }
+            }
+
+            layer.swap(next);
+        }
+    }
+
+    int getRadius() const {
+        return radius;
+    }
+
+    size_t size() const {
+        return distances.size();
+    }
+
+    // Exact distance to the goal, or -1 outside the perimeter. Boards pack
+    // the same in every representation, so any puzzle type can look up.
+    template <typename State>
+    int distance(const State& p) const {
+        auto it = distances.find(pack(p));
+        return it == distances.end() ? -1 : it->second;
+    }
+
+    // The steps from a state inside the perimeter down to the goal.
+    template <typename State>
+    std::vector<Step> descend(State node) const {
+        std::vector<Step> moves;
+        int d = distance(node);
+
+        while (d > 0) {
+            bool found = false;
+
+            for (Step s : steps) {
+                if (node.canStep(s) && distance(node.child(s)) == d - 1) {
+                    node.makeStep(s);
+                    moves.push_back(s);
+                    d--;
+                    found = true;
+                    break;
+                }
+            }
+
+            if (!found) {
+                throw "Perimeter database has no step down";
+            }
+        }
+
+        return moves;
+    }
+};
+
+// Pattern databases over the blank and a set of tiles. An abstract state is
+// the cells of those items, and every move costs one, so the distance to the
+// abstract goal is a lower bound on the real one. States are ranked as
+// k-permutations of the cells (radices n, n - 1, ...), one byte each.
+//
+// On disk a table is a PatternHeader followed by entries bytes, 255 for
+// ranks no state reaches. The in-memory and external builders write the same
+// file for the same pattern.
+struct PatternHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint8_t side;
+    uint8_t pos0;
+    uint8_t items;
+    uint8_t reserved[7];
+    uint64_t entries;
+    uint8_t tiles[32];
+};
+
+const uint32_t patternMagic = 0x4244504e;
+
+class PatternSpace {
+private:
+    int side;
+    int cells;
+    std::vector<int> tiles;
+
+public:
+    PatternSpace(int otherSide, const std::vector<int>& otherTiles) : side(otherSide), cells(otherSide * otherSide),
+                                                                      tiles(otherTiles) {
+        if (cells > 64 || tiles.size() + 1 > 32 || (int) tiles.size() >= cells) {
+            throw "Pattern too large";
+        }
+    }
+
+    int items() const {
+        return tiles.size() + 1;
+    }
+
+    uint64_t size() const {
+        uint64_t entries = 1;
+
+        for (int i = 0; i < items(); i++) {
+            entries *= cells - i;
+        }
+
+        return entries;
+    }
+
+    uint64_t rank(const int* positions) const {
+        uint64_t rank = 0, used = 0;
+
+        for (int i = 0; i < items(); i++) {
+            int smaller = __builtin_popcountll(used & ((1ULL << positions[i]) - 1));
+            rank = rank * (cells - i) + positions[i] - smaller;
+            used |= 1ULL << positions[i];
+        }
+
+        return rank;
+    }
+
+    void unrank(uint64_t rank, int* positions) const {
+        int digits[32];
+
+        for (int i = items() - 1; i >= 0; i--) {
+            digits[i] = rank % (cells - i);
+            rank /= cells - i;
+        }
+
+        uint64_t used = 0;
+
+        for (int i = 0; i < items(); i++) {
+            int cell = 0;
+
+            for (int skip = digits[i]; ; cell++) {
+                if (!(used & (1ULL << cell)) && skip-- == 0) {
+                    break;
+                }
+            }
+
+            positions[i] = cell;
+            used |= 1ULL << cell;
+        }
+    }
+
+    uint64_t goal(int pos0) const {
+        int positions[32];
+        positions[0] = pos0;
+
+        for (size_t t = 0; t < tiles.size(); t++) {
+            positions[t + 1] = goalCell(tiles[t], pos0);
+        }
+
+        return rank(positions);
+    }
+
+    // Any puzzle type can be ranked, since only its cells are read.
+    template <typename State>
+    uint64_t rankOf(const State& p) const {
+        int positions[32];
+
+        for (int cell = 0; cell < cells; cell++) {
+            int value = p.at(cell / side, cell % side);
+
+            if (value == 0) {
+                positions[0] = cell;
+            }
+
+            for (size_t t = 0; t < tiles.size(); t++) {
+                if (tiles[t] == value) {
+                    positions[t + 1] = cell;
+                }
+            }
+        }
+
+        return rank(positions);
+    }
+
+    // Ranks of the states one blank move away.
+    template <typename Visit>
+    void neighbours(uint64_t state, Visit visit) const {
+        int positions[32];
+        unrank(state, positions);
+
+        int blank = positions[0];
+        int next[] = {blank >= side ? blank - side : -1, blank + side < cells ? blank + side : -1,
+                      blank % side > 0 ? blank - 1 : -1, blank % side < side - 1 ? blank + 1 : -1};
+
+        for (int cell : next) {
+            if (cell < 0) {
+                continue;
+            }
+
+            int moved = 0;
+
+            for (int i = 1; i < items(); i++) {
+                if (positions[i] == cell) {
+                    moved = i;
+                }
+            }
+
+            positions[0] = cell;
+            if (moved) {
+                positions[moved] = blank;
+            }
+
+            visit(rank(positions));
+
+            positions[0] = blank;
+            if (moved) {
+                positions[moved] = cell;
+            }
+        }
+    }
+
+    PatternHeader header(int pos0) const {
+        PatternHeader header = {};
+        header.magic = patternMagic;
+        header.version = 1;
+        header.side = side;
+        header.pos0 = pos0;
+        header.items = items();
+        header.entries = size();
+
+        for (size_t t = 0; t < tiles.size(); t++) {
+            header.tiles[t] = tiles[t];
+        }
+
+        return header;
+    }
+};
+
+// A sorted file of 64-bit ranks read front to back.
+class SortedRun {
+private:
+    FILE* file;
+    std::vector<char> buffer;
+
+public:
+    uint64_t value;
+    bool more;
+
+    explicit SortedRun(const std::string& path) : file(fopen(path.c_str(), "rb")), buffer(1 << 16), more(true) {
+        if (!file) {
+            throw "Cannot open pattern database run";
+        }
+
+        setvbuf(file, buffer.data(), _IOFBF, buffer.size());
+        advance();
+    }
+
+    ~SortedRun() {
+        fclose(file);
+    }
+
+    void advance() {
+        more = fread(&value, sizeof(value), 1, file) == 1;
+    }
+
+    // Skips to the first value >= target; true if it equals target.
+    bool contains(uint64_t target) {
+        while (more && value < target) {
+            advance();
+        }
+
+        return more && value == target;
+    }
+};
+
+inline void writeRanks(const std::string& path, const std::vector<uint64_t>& ranks) {
+    FILE* out = fopen(path.c_str(), "wb");
+
+    if (!out || fwrite(ranks.data(), sizeof(uint64_t), ranks.size(), out) != ranks.size()) {
+        throw "Cannot write pattern database run";
+    }
+
+    fclose(out);
+}
+
+// Most runs one merge reads at once, each an open file.
+const int mergeFanIn = 64;
+
+// Merges sorted runs into one sorted run without duplicates, and deletes
+// them.
+inline void mergeRuns(const std::vector<std::string>& inputs, const std::string& output) {
+    FILE* out = fopen(output.c_str(), "wb");
+    std::vector<char> outBuffer(1 << 16);
+
+    if (!out) {
+        throw "Cannot write pattern database run";
+    }
+
+    setvbuf(out, outBuffer.data(), _IOFBF, outBuffer.size());
+
+    {
+        std::vector<std::unique_ptr<SortedRun>> readers;
+        typedef std::pair<uint64_t, size_t> Head;
+        std::priority_queue<Head, std::vector<Head>, std::greater<Head>> heads;
+        uint64_t last = UINT64_MAX;
+
+        for (const std::string& input : inputs) {
+            readers.emplace_back(new SortedRun(input));
+
+            if (readers.back()->more) {
+                heads.push(Head(readers.back()->value, readers.size() - 1));
+            }
+        }
+
+        while (!heads.empty()) {
+            Head head = heads.top();
+            heads.pop();
+
+            if (head.first != last) {
+                fwrite(&head.first, sizeof(head.first), 1, out);
+            }
+
+            last = head.first;
+            SortedRun& reader = *readers[head.second];
+            reader.advance();
+
+            if (reader.more) {
+                heads.push(Head(reader.value, head.second));
+            }
+        }
+    }
+
+    if (fclose(out) != 0) {
+        throw "Cannot write pattern database run";
+    }
+
+    for (const std::string& input : inputs) {
+        unlink(input.c_str());
+    }
+}
+
+// Breadth-first search in memory: the table doubles as the visited set.
+inline void buildPatternDatabase(const PatternSpace& space, int pos0, const std::string& path, int& maxDepth) {
+    std::vector<uint8_t> table(space.size(), 255);
+    std::vector<uint64_t> layer(1, space.goal(pos0)), next;
+    table[layer[0]] = 0;
+    maxDepth = 0;
+
+    for (int depth = 1; !layer.empty(); depth++) {
+        next.clear();
+
+        for (uint64_t state : layer) {
+            space.neighbours(state, [&](uint64_t neighbour) {
+                if (table[neighbour] == 255) {
+                    table[neighbour] = depth;
+                    next.push_back(neighbour);
+                }
+            });
+        }
+
+        if (!next.empty()) {
+            maxDepth = depth;
+        }
+
+        layer.swap(next);
+    }
+
+    FILE* out = fopen(path.c_str(), "wb");
+    PatternHeader header = space.header(pos0);
+
+    if (!out || fwrite(&header, sizeof(header), 1, out) != 1 ||
+        fwrite(table.data(), 1, table.size(), out) != table.size()) {
+        throw "Cannot write pattern database";
+    }
+
+    fclose(out);
+}
+
+// Merges runs in groups of at most fanIn until no more than fanIn are left.
+inline void mergeInPasses(std::vector<std::string>& runs, const std::string& prefix, int fanIn) {
+    for (int pass = 0; (int) runs.size() > fanIn; pass++) {
+        std::vector<std::string> merged;
+
+        for (size_t first = 0; first < runs.size(); first += fanIn) {
+            size_t last = std::min(runs.size(), first + fanIn);
+
+            merged.push_back(prefix + std::to_string(pass) + "." + std::to_string(merged.size()));
+            mergeRuns(std::vector<std::string>(runs.begin() + first, runs.begin() + last), merged.back());
+        }
+
+        runs.swap(merged);
+    }
+}
+
+// Breadth-first search on disk with delayed duplicate detection. Each layer
+// is a sorted file of ranks. Successors of a layer are gathered in RAM up to
+// the budget, sorted and written as runs; the runs are merged, at most
+// fanIn at a time, and because every neighbour of layer d lies in layer
+// d - 1, d or d + 1, subtracting the two previous layers in the last pass
+// leaves exactly layer d + 1. All files are read and written sequentially.
+// Every layer is also written tagged with its depth (rank * 256 + depth), so
+// that the table is assembled by merging those in rank order, again at most
+// fanIn at a time. fanIn is capped to fit the process's file limit.
+inline void buildPatternDatabaseExternal(const PatternSpace& space, int pos0, const std::string& path,
+                                         size_t memoryBytes, int& maxDepth, int& runCount, int fanIn = mergeFanIn) {
+    auto layerPath = [&](int depth) { return path + ".layer" + std::to_string(depth); };
+    auto taggedPath = [&](int depth) { return path + ".tagged" + std::to_string(depth); };
+    size_t capacity = std::max<size_t>(1024, memoryBytes / sizeof(uint64_t));
+    std::vector<uint64_t> buffer;
+    struct rlimit files;
+
+    if (space.size() > (UINT64_MAX >> 8)) {
+        throw "Pattern too large";
+    }
+
+    // A layer merge also holds the two previous layers, its two outputs and
+    // the standard streams open.
+    if (getrlimit(RLIMIT_NOFILE, &files) == 0 && files.rlim_cur != RLIM_INFINITY) {
+        fanIn = std::min<long long>(fanIn, (long long) files.rlim_cur - 8);
+    }
+
+    fanIn = std::max(2, fanIn);
+
+    writeRanks(layerPath(0), std::vector<uint64_t>(1, space.goal(pos0)));
+    writeRanks(taggedPath(0), std::vector<uint64_t>(1, space.goal(pos0) << 8));
+    writeRanks(path + ".empty", std::vector<uint64_t>());
+    maxDepth = 0;
+    runCount = 0;
+
+    for (int depth = 0; ; depth++) {
+        std::vector<std::string> runs;
+
+        auto spill = [&]() {
+            std::sort(buffer.begin(), buffer.end());
+            buffer.erase(std::unique(buffer.begin(), buffer.end()), buffer.end());
+            runs.push_back(path + ".run" + std::to_string(runs.size()));
+            writeRanks(runs.back(), buffer);
+            buffer.clear();
+        };
+
+        {
+            SortedRun layer(layerPath(depth));
+
+            for (; layer.more; layer.advance()) {
+                space.neighbours(layer.value, [&](uint64_t neighbour) {
+                    buffer.push_back(neighbour);
+
+                    if (buffer.size() >= capacity) {
+                        spill();
+                    }
+                });
+            }
+        }
+
+        if (!buffer.empty()) {
+            spill();
+        }
+
+        runCount += runs.size();
+        mergeInPasses(runs, path + ".merge", fanIn);
+
+        FILE* out = fopen(layerPath(depth + 1).c_str(), "wb");
+        FILE* tagged = fopen(taggedPath(depth + 1).c_str(), "wb");
+        std::vector<char> outBuffer(1 << 16), taggedBuffer(1 << 16);
+        uint64_t written = 0;
+
+        if (!out || !tagged) {
+            throw "Cannot write pattern database layer";
+        }
+
+        setvbuf(out, outBuffer.data(), _IOFBF, outBuffer.size());
+        setvbuf(tagged, taggedBuffer.data(), _IOFBF, taggedBuffer.size());
+
+        {
+            std::vector<std::unique_ptr<SortedRun>> readers;
+            typedef std::pair<uint64_t, size_t> Head;
+            std::priority_queue<Head, std::vector<Head>, std::greater<Head>> heads;
+            SortedRun current(layerPath(depth));
+            SortedRun previous(depth > 0 ? layerPath(depth - 1) : path + ".empty");
+            uint64_t last = UINT64_MAX;
+
+            for (const std::string& run : runs) {
+                readers.emplace_back(new SortedRun(run));
+
+                if (readers.back()->more) {
+                    heads.push(Head(readers.back()->value, readers.size() - 1));
+                }
+            }
+
+            while (!heads.empty()) {
+                Head head = heads.top();
+                heads.pop();
+
+                if (head.first != last && !current.contains(head.first) && !previous.contains(head.first)) {
+                    uint64_t entry = head.first << 8 | (depth + 1);
+
+                    fwrite(&head.first, sizeof(head.first), 1, out);
+                    fwrite(&entry, sizeof(entry), 1, tagged);
+                    written++;
+                }
+
+                last = head.first;
+                SortedRun& reader = *readers[head.second];
+                reader.advance();
+
+                if (reader.more) {
+                    heads.push(Head(reader.value, head.second));
+                }
+            }
+        }
+
+        fclose(out);
+        fclose(tagged);
+
+        for (const std::string& run : runs) {
+            unlink(run.c_str());
+        }
+
+        if (written == 0) {
+            unlink(layerPath(depth + 1).c_str());
+            unlink(taggedPath(depth + 1).c_str());
+            maxDepth = depth;
+            break;
+        }
+    }
+
+    for (int depth = 0; depth <= maxDepth; depth++) {
+        unlink(layerPath(depth).c_str());
+    }
+
+    unlink((path + ".empty").c_str());
+
+    std::vector<std::string> layers;
+
+    for (int depth = 0; depth <= maxDepth; depth++) {
+        layers.push_back(taggedPath(depth));
+    }
+
+    mergeInPasses(layers, path + ".assemble", fanIn);
+
+    FILE* out = fopen(path.c_str(), "wb");
+    std::vector<char> outBuffer(1 << 20);
+    PatternHeader header = space.header(pos0);
+
+    if (!out || fwrite(&header, sizeof(header), 1, out) != 1) {
+        throw "Cannot write pattern database";
+    }
+
+    setvbuf(out, outBuffer.data(), _IOFBF, outBuffer.size());
+
+    {
+        std::vector<std::unique_ptr<SortedRun>> readers;
+        typedef std::pair<uint64_t, size_t> Head;
+        std::priority_queue<Head, std::vector<Head>, std::greater<Head>> heads;
+        std::vector<uint8_t> gap(1 << 16, 255);
+        uint64_t next = 0;
+
+        for (const std::string& layer : layers) {
+            readers.emplace_back(new SortedRun(layer));
+
+            if (readers.back()->more) {
+                heads.push(Head(readers.back()->value, readers.size() - 1));
+            }
+        }
+
+        while (!heads.empty()) {
+            Head head = heads.top();
+            heads.pop();
+
+            uint64_t rank = head.first >> 8;
+
+            while (next < rank) {
+                uint64_t count = std::min<uint64_t>(gap.size(), rank - next);
+                fwrite(gap.data(), 1, count, out);
+                next += count;
+            }
+
+            uint8_t depth = head.first & 255;
+            fwrite(&depth, 1, 1, out);
+            next++;
+
+            SortedRun& reader = *readers[head.second];
+            reader.advance();
+
+            if (reader.more) {
+                heads.push(Head(reader.value, head.second));
+            }
+        }
+
+        while (next < space.size()) {
+            uint64_t count = std::min<uint64_t>(gap.size(), space.size() - next);
+            fwrite(gap.data(), 1, count, out);
+            next += count;
+        }
+    }
+
+    fclose(out);
+
+    for (const std::string& layer : layers) {
+        unlink(layer.c_str());
+    }
+}
+
+// A built table, memory-mapped read-only so that every process using it
+// shares the page cache copy. With huge pages the mapping is marked with
+// madvise(MADV_HUGEPAGE); the kernel backs a file mapping with huge pages
+// only when it supports them for read-only files, otherwise it keeps base
+// pages, as getPageSize() reports. Copying the file into private huge pages
+// would make them certain but cost every process its own copy.
+class PatternDatabase {
+private:
+    int side;
+    int pos0;
+    std::unique_ptr<PatternSpace> space;
+    const uint8_t* table;
+    size_t bytes;
+    void* mapping;
+
+    void load() {
+        const PatternHeader* header = static_cast<const PatternHeader*>(mapping);
+
+        if (header->magic != patternMagic || header->version != 1) {
+            throw "Not a pattern database";
+        }
+
+        int cells = header->side * header->side;
+
+        if (header->side < 2 || cells > 64 || header->pos0 >= cells || header->items < 1 ||
+            header->items > (int) sizeof(header->tiles) || header->items > cells) {
+            throw "Invalid pattern database header";
+        }
+
+        uint64_t seen = 0;
+
+        for (int t = 0; t + 1 < header->items; t++) {
+            if (header->tiles[t] < 1 || header->tiles[t] >= cells || (seen >> header->tiles[t] & 1)) {
+                throw "Invalid pattern database header";
+            }
+
+            seen |= 1ULL << header->tiles[t];
+        }
+
+        side = header->side;
+        pos0 = header->pos0;
+        space.reset(new PatternSpace(header->side, std::vector<int>(header->tiles, header->tiles + header->items - 1)));
+
+        if (header->entries != space->size() || bytes != sizeof(PatternHeader) + space->size()) {
+            throw "Truncated pattern database";
+        }
+
+        table = static_cast<const uint8_t*>(mapping) + sizeof(PatternHeader);
+    }
+
+public:
+    explicit PatternDatabase(const std::string& path, bool huge = hugePageTables) {
+        int fd = open(path.c_str(), O_RDONLY);
+        struct stat info;
+
+        if (fd < 0) {
+            throw "Cannot open pattern database";
+        }
+
+        if (fstat(fd, &info) != 0 || (size_t) info.st_size < sizeof(PatternHeader)) {
+            close(fd);
+            throw "Cannot open pattern database";
+        }
+
+        bytes = info.st_size;
+        mapping = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+
+        if (mapping == MAP_FAILED) {
+            throw "Cannot map pattern database";
+        }
+
+        madvise(mapping, bytes, huge ? MADV_HUGEPAGE : MADV_NOHUGEPAGE);
+
+        try {
+            load();
+        }
+        catch (...) {
+            munmap(mapping, bytes);
+            throw;
+        }
+    }
+
+    PatternDatabase(const PatternDatabase&) = delete;
+    PatternDatabase& operator=(const PatternDatabase&) = delete;
+
+    ~PatternDatabase() {
+        munmap(mapping, bytes);
+    }
+
+    size_t getPageSize() const {
+        return backingPageSize(table);
+    }
+
+    template <typename State>
+    bool covers(const State& p) const {
+        return p.getSide() == side && p.getPos0() == pos0;
+    }
+
+    template <typename State>
+    int distance(const State& p) const {
+        return table[space->rankOf(p)];
+    }
+};
+
+#endif
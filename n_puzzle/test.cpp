@@ -0,0 +1,529 @@
+#include "service.h"
+#include "macro.h"
+#include "verify.h"
+
+#include <fstream>
+#include <sys/wait.h>
+
+// Plays the moves on the board and checks that they reach the goal.
+bool solves(const Instance& instance, const std::string& moves) {
+    Puzzle p(instance.cells, instance.side, instance.pos0);
+
+    for (char c : moves) {
+        Step s = letterStep(c);
+
+        if (!p.canStep(s)) {
+            return false;
+        }
+
+        p.makeStep(s);
+    }
+
+    return p.isGoal();
+}
+
+// Every board must get the reference length, and moves that solve it; the
+// unsolvable ones must get -1. Returns the number of failures.
+template <typename Board, typename Heuristic, typename Engine>
+long long checkSolver(const std::vector<Instance>& corpus, const std::vector<int>& lengths) {
+    typedef Solver<Board, Heuristic, Engine> Tested;
+    long long failures = 0;
+
+    for (size_t k = 0; k < corpus.size(); k++) {
+        Solution solution = Tested::solve(corpus[k]);
+
+        if (solution.length != lengths[k] ||
+            (solution.length >= 0 && ((int) solution.moves.size() != solution.length ||
+                                      !solves(corpus[k], solution.moves)))) {
+            if (failures++ < 5) {
+                std::cout << Tested::name() << ": board " << k << " got length " << solution.length
+                          << ", expected " << lengths[k] << std::endl;
+            }
+        }
+    }
+
+    std::cout << Tested::name() << ": " << corpus.size() << " boards, " << failures << " failures" << std::endl;
+
+    return failures;
+}
+
+// Macro solutions of the solvable boards, shortened by the path optimizer,
+// must still solve them and be no longer than before.
+long long checkOptimizer(const std::vector<Instance>& corpus, const std::vector<int>& lengths) {
+    long long failures = 0;
+
+    for (size_t k = 0; k < corpus.size(); k++) {
+        if (lengths[k] < 0) {
+            continue;
+        }
+
+        std::ostringstream moves;
+        MacroSolver(corpus[k], moves).solve();
+
+        std::string shorter = PathOptimizer(corpus[k].side, 8, 2).optimize(corpus[k].cells, moves.str());
+
+        if (!solves(corpus[k], shorter) || shorter.size() > moves.str().size() || (int) shorter.size() < lengths[k]) {
+            if (failures++ < 5) {
+                std::cout << "optimizer: board " << k << " got " << shorter.size() << " moves from "
+                          << moves.str().size() << std::endl;
+            }
+        }
+    }
+
+    std::cout << "optimizer: " << corpus.size() << " boards, " << failures << " failures" << std::endl;
+
+    return failures;
+}
+
+// An instance in the input format: n, the blank's goal cell, then the cells.
+std::string boardText(const Instance& instance) {
+    std::ostringstream text;
+    text << instance.side * instance.side - 1 << '\n' << instance.pos0 << '\n';
+
+    for (int value : instance.cells) {
+        text << value << ' ';
+    }
+
+    text << '\n';
+
+    return text.str();
+}
+
+// Reads one "length\nmoves\n" solution and checks it against the board.
+bool solvedIn(std::istream& in, const Instance& instance, int length) {
+    std::string lengthLine, moves;
+
+    if (!std::getline(in, lengthLine) || !std::getline(in, moves)) {
+        return false;
+    }
+
+    return atoi(lengthLine.c_str()) == length &&
+           (length < 0 || ((int) moves.size() == length && solves(instance, moves)));
+}
+
+// Boards past the engines' limit must still be read and macro-solved: the
+// board is a random walk from the goal, written out and parsed back, and
+// the moves are replayed on the cells, since no puzzle can be built for it.
+long long checkLargeBoard() {
+    const int side = maxPuzzleSide + 8;
+    long long failures = 0;
+    Instance walked = {side, side * side - 1, std::vector<int>(side * side)};
+    std::mt19937 random(1);
+    int blank = side * side - 1;
+
+    for (int cell = 0; cell < side * side; cell++) {
+        walked.cells[cell] = (cell + 1) % (side * side);
+    }
+
+    for (int k = 0; k < 100000; k++) {
+        int cells[] = {blank - side, blank + side, blank % side > 0 ? blank - 1 : -1,
+                       blank % side < side - 1 ? blank + 1 : -1};
+        int cell = cells[random() % 4];
+
+        if (cell >= 0 && cell < side * side) {
+            std::swap(walked.cells[blank], walked.cells[cell]);
+            blank = cell;
+        }
+    }
+
+    std::string text = boardText(walked);
+    InstanceReader reader(text.data(), text.size());
+    Instance instance;
+    std::ostringstream moves;
+
+    if (!reader.next(instance) || instance.cells != walked.cells) {
+        failures++;
+    }
+    else {
+        MacroSolver(instance, moves).solve();
+
+        for (char c : moves.str()) {
+            int cell = c == 'U' ? blank + side : (c == 'D' ? blank - side : (c == 'L' ? blank + 1 : blank - 1));
+            std::swap(instance.cells[blank], instance.cells[cell]);
+            blank = cell;
+        }
+
+        for (int cell = 0; cell < side * side; cell++) {
+            failures += instance.cells[cell] != (cell + 1) % (side * side);
+        }
+    }
+
+    std::cout << "large board: " << side << "x" << side << ", " << moves.str().size() << " moves, " << failures
+              << " failures" << std::endl;
+
+    return failures;
+}
+
+// Boards within the perimeter must get their exact distance, in every
+// representation, and a path down to the goal of that length; IDA* through
+// the perimeter must still find the reference lengths.
+long long checkPerimeter(const std::vector<Instance>& corpus, const std::vector<int>& lengths) {
+    const int radius = 8;
+    long long failures = 0;
+    PerimeterDatabase perimeter(4, 15, radius);
+    InstanceGenerator walks(4, 15, radius, 0, INT_MAX, 1);
+    Instance instance;
+
+    for (int k = 0; k < 8; k++) {
+        walks.next(instance);
+
+        Puzzle p(instance.cells, instance.side, instance.pos0);
+        BasicPuzzle<FlatBoard, ManhattanDistance> flat(instance.cells, instance.side, instance.pos0);
+        std::string moves;
+
+        for (Step s : perimeter.descend(p)) {
+            moves += stepLetter(s);
+        }
+
+        int d = perimeter.distance(p);
+
+        if (d != Solver<>::solve(instance).length || perimeter.distance(flat) != d || (int) moves.size() != d ||
+            !solves(instance, moves)) {
+            failures++;
+        }
+    }
+
+    for (size_t k = 0; k < corpus.size(); k++) {
+        if (corpus[k].side == 4 && corpus[k].pos0 == 15 &&
+            idaStar(Puzzle(corpus[k].cells, 4, 15), &perimeter).second != lengths[k]) {
+            failures++;
+        }
+    }
+
+    std::cout << "perimeter: " << perimeter.size() << " states, " << failures << " failures" << std::endl;
+
+    return failures;
+}
+
+void keepSignal(int) {
+}
+
+// A resumable search stopped by SIGINT must leave a checkpoint that the next
+// run on the same board resumes to the reference length, and that a run on
+// another board ignores. The handlers in place before must be back after the
+// search was suspended.
+long long checkCheckpoint(const std::vector<Instance>& corpus, const std::vector<int>& lengths,
+                          const std::string& file) {
+    long long failures = 0;
+    size_t first = corpus.size() - 2, second = corpus.size() - 1;
+    Puzzle suspended(corpus[first].cells, corpus[first].side, corpus[first].pos0);
+    Puzzle other(corpus[second].cells, corpus[second].side, corpus[second].pos0);
+
+    for (int run = 0; run < 2; run++) {
+        signal(SIGUSR1, keepSignal);
+        checkpointSignal = SIGINT;
+
+        try {
+            resumableIdaStar(suspended, file, 0);
+            failures++;
+        }
+        catch (const char* message) {
+            failures += std::string(message) != "Search suspended";
+        }
+
+        failures += signal(SIGUSR1, SIG_DFL) != keepSignal;
+        failures += access(file.c_str(), F_OK) != 0;
+
+        Puzzle resumed = run == 0 ? suspended : other;
+        int length = resumableIdaStar(resumed, file, 0).second;
+
+        failures += length != lengths[run == 0 ? first : second];
+        failures += access(file.c_str(), F_OK) == 0;
+    }
+
+    std::cout << "checkpoint: " << failures << " failures" << std::endl;
+
+    return failures;
+}
+
+// The solution cache must return what was stored, miss other boards, keep
+// entries across opens, and read a slot left mid-write by a dead writer (an
+// odd sequence) as a miss, whose slot the next store of any board reclaims.
+long long checkCache(const std::vector<Instance>& corpus, const std::string& file) {
+    const int slots = 8;
+    long long failures = 0;
+    Puzzle first(corpus[0].cells, corpus[0].side, corpus[0].pos0);
+    Puzzle second(corpus[1].cells, corpus[1].side, corpus[1].pos0);
+    SolutionCache::Entry stored = {5, 3, "UDLRU"}, entry;
+
+    // The file is a 16-byte header, then the slots, each starting with its
+    // sequence number. All slots form one set, filled from the first.
+    auto firstSequence = [&](uint32_t add) {
+        int fd = open(file.c_str(), O_RDWR);
+        uint32_t sequence = 0;
+
+        if (fd >= 0 && pread(fd, &sequence, sizeof(sequence), 16) == sizeof(sequence)) {
+            sequence += add;
+
+            if (add && pwrite(fd, &sequence, sizeof(sequence), 16) != sizeof(sequence)) {
+                sequence = 0;
+            }
+        }
+
+        if (fd >= 0) {
+            close(fd);
+        }
+
+        return sequence;
+    };
+
+    unlink(file.c_str());
+
+    {
+        SolutionCache cache(file, slots);
+        cache.store(first, stored);
+        failures += !cache.lookup(first, entry) || entry.length != 5 || entry.lowerBound != 3 || entry.moves != "UDLRU";
+        failures += cache.lookup(second, entry);
+    }
+
+    failures += (firstSequence(1) & 1) == 0;
+
+    {
+        SolutionCache cache(file, slots);
+        failures += cache.lookup(first, entry);
+        cache.store(second, stored);
+        failures += !cache.lookup(second, entry) || entry.moves != "UDLRU";
+    }
+
+    failures += (firstSequence(0) & 1) != 0;
+
+    unlink(file.c_str());
+
+    std::cout << "cache: " << failures << " failures" << std::endl;
+
+    return failures;
+}
+
+// Pattern databases of the 3x3 board built in memory and externally (with a
+// buffer small enough to need several runs, merged two at a time) must be
+// the same file, read 0 at the goal and never more than the optimal length,
+// in every representation.
+long long checkPatternDatabase(const std::string& file) {
+    long long failures = 0;
+    PatternSpace space(3, {1, 2, 3, 4});
+    std::string external = file + ".external";
+    int maxDepth, externalDepth, runs;
+
+    buildPatternDatabase(space, 8, file, maxDepth);
+    buildPatternDatabaseExternal(space, 8, external, 4096, externalDepth, runs, 2);
+
+    std::ifstream built(file, std::ios::binary), merged(external, std::ios::binary);
+    std::string builtBytes((std::istreambuf_iterator<char>(built)), std::istreambuf_iterator<char>());
+    std::string mergedBytes((std::istreambuf_iterator<char>(merged)), std::istreambuf_iterator<char>());
+
+    failures += builtBytes.empty() || builtBytes != mergedBytes || maxDepth != externalDepth || runs < 2;
+
+    PatternDatabase pdb(file);
+    InstanceGenerator generator(3, 8, 0, 0, INT_MAX, 1);
+    Instance instance;
+
+    failures += !pdb.covers(goalPuzzle(3, 8)) || pdb.distance(goalPuzzle(3, 8)) != 0;
+
+    for (int k = 0; k < 16; k++) {
+        generator.next(instance);
+
+        Puzzle p(instance.cells, instance.side, instance.pos0);
+        BasicPuzzle<FlatBoard, ManhattanDistance> flat(instance.cells, instance.side, instance.pos0);
+        int length = Solver<>::solve(instance).length;
+
+        failures += pdb.distance(p) != pdb.distance(flat) || (length >= 0 && pdb.distance(p) > length);
+    }
+
+    unlink(file.c_str());
+    unlink(external.c_str());
+
+    std::cout << "pattern database: " << space.size() << " entries, " << failures << " failures" << std::endl;
+
+    return failures;
+}
+
+// The pipeline must write one solution per board, in input order, whatever
+// order its workers finish in.
+long long checkPipeline(const std::vector<Instance>& corpus, const std::vector<int>& lengths) {
+    long long failures = 0;
+    Options options;
+    std::string input;
+    std::ostringstream output;
+
+    options.workers = 3;
+    options.queueSize = 2;
+
+    for (const Instance& instance : corpus) {
+        input += boardText(instance);
+    }
+
+    InstanceReader reader(input.data(), input.size());
+    std::streambuf* console = std::cout.rdbuf(output.rdbuf());
+
+    try {
+        runPipeline(options, reader, nullptr);
+    }
+    catch (...) {
+        std::cout.rdbuf(console);
+        throw;
+    }
+
+    std::cout.rdbuf(console);
+
+    std::istringstream in(output.str());
+
+    for (size_t k = 0; k < corpus.size(); k++) {
+        failures += !solvedIn(in, corpus[k], lengths[k]);
+    }
+
+    std::cout << "pipeline: " << corpus.size() << " boards, " << failures << " failures" << std::endl;
+
+    return failures;
+}
+
+// A daemon in a child process must answer SOLVE requests with solutions, a
+// malformed board with an ERROR reply while it keeps serving, and STATS with
+// its counters.
+long long checkDaemon(const std::vector<Instance>& corpus, const std::vector<int>& lengths, const std::string& path) {
+    long long failures = 0;
+
+    std::cout.flush();
+
+    pid_t child = fork();
+
+    if (child == 0) {
+        Options options;
+        options.workers = 2;
+        options.queueSize = 4;
+
+        try {
+            SolverDaemon(options, nullptr).run(path);
+        }
+        catch (const char* message) {
+            fprintf(stderr, "%s\n", message);
+        }
+
+        _exit(1);
+    }
+
+    sockaddr_un address = socketAddress(path);
+    int fd = -1;
+
+    for (int tries = 0; tries < 200 && fd < 0; tries++) {
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+        if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+            close(fd);
+            fd = -1;
+            usleep(10000);
+        }
+    }
+
+    std::string reply;
+
+    if (fd < 0) {
+        failures++;
+    }
+    else {
+        for (size_t k = 0; k < corpus.size(); k++) {
+            std::istringstream in(writeMessage(fd, "SOLVE 0\n" + boardText(corpus[k])) && readMessage(fd, reply)
+                                  ? reply : "");
+            failures += !solvedIn(in, corpus[k], lengths[k]);
+        }
+
+        failures += !writeMessage(fd, "SOLVE 0\n8\n8\n1 1 2 3 4 5 6 7 8\n") || !readMessage(fd, reply) ||
+                    reply.rfind("ERROR ", 0) != 0;
+        failures += !writeMessage(fd, "STATS\n") || !readMessage(fd, reply) ||
+                    reply.find("solved " + std::to_string(corpus.size()) + "\n") == std::string::npos ||
+                    reply.find("errors 1\n") == std::string::npos;
+
+        close(fd);
+    }
+
+    kill(child, SIGKILL);
+    waitpid(child, nullptr, 0);
+    unlink(path.c_str());
+
+    std::cout << "daemon: " << corpus.size() << " boards, " << failures << " failures" << std::endl;
+
+    return failures;
+}
+
+template <typename Board, typename Heuristic>
+long long checkEngines(const std::vector<Instance>& corpus, const std::vector<int>& lengths) {
+    return checkSolver<Board, Heuristic, IdaEngine>(corpus, lengths) +
+           checkSolver<Board, Heuristic, EpeaEngine>(corpus, lengths) +
+           checkSolver<Board, Heuristic, RbfsEngine>(corpus, lengths) +
+           checkSolver<Board, Heuristic, ControlledEngine>(corpus, lengths);
+}
+
+// Test driver: the heuristic checks of verify mode, then every combination
+// of representation, heuristic and engine on random 3x3 boards for every
+// blank goal, plus unsolvable ones and random walks on 4x4, the parallel and
+// resumable engines, and the path optimizer on macro solutions. Lengths are
+// checked against EPEA* with the default puzzle. Then a board too large for
+// the engines through macro mode, the perimeter and pattern databases,
+// checkpoints, the solution cache, the pipeline and the daemon, with their
+// files under /tmp. Exits non-zero on any failure.
+int main(int argc, char** argv) {
+    try {
+        Options options = parseOptions(argc, argv);
+        long long failures = verifyHeuristics(options);
+        std::vector<Instance> corpus;
+        Instance instance;
+
+        for (int pos0 = 0; pos0 < 9; pos0++) {
+            InstanceGenerator generator(3, pos0, 0, 0, INT_MAX, options.seed + pos0);
+
+            for (int k = 0; k < 2; k++) {
+                generator.next(instance);
+                corpus.push_back(instance);
+            }
+        }
+
+        // Swapping two tiles flips the parity of a board.
+        instance = corpus[0];
+        int first = instance.cells[0] == 0 ? 1 : 0;
+        int second = instance.cells[first + 1] == 0 ? first + 2 : first + 1;
+        std::swap(instance.cells[first], instance.cells[second]);
+        corpus.push_back(instance);
+
+        InstanceGenerator walks(4, 15, 30, 0, INT_MAX, options.seed);
+
+        for (int k = 0; k < 4; k++) {
+            walks.next(instance);
+            corpus.push_back(instance);
+        }
+
+        std::vector<int> lengths;
+
+        for (const Instance& board : corpus) {
+            lengths.push_back(Solver<VectorBoard, LinearConflict, EpeaEngine>::solve(board).length);
+        }
+
+        failures += checkEngines<VectorBoard, ManhattanDistance>(corpus, lengths);
+        failures += checkEngines<VectorBoard, LinearConflict>(corpus, lengths);
+        failures += checkEngines<FlatBoard, ManhattanDistance>(corpus, lengths);
+        failures += checkEngines<FlatBoard, LinearConflict>(corpus, lengths);
+        failures += checkSolver<FlatBoard, HierarchicalHeuristic, IdaEngine>(corpus, lengths);
+        failures += checkSolver<VectorBoard, LinearConflict, ParallelEngine>(corpus, lengths);
+        failures += checkSolver<FlatBoard, ManhattanDistance, ParallelEngine>(corpus, lengths);
+        failures += checkSolver<VectorBoard, LinearConflict, WindowEngine>(corpus, lengths);
+        failures += checkSolver<FlatBoard, ManhattanDistance, WindowEngine>(corpus, lengths);
+        failures += checkSolver<VectorBoard, LinearConflict, ResumableEngine>(corpus, lengths);
+        failures += checkSolver<FlatBoard, ManhattanDistance, ResumableEngine>(corpus, lengths);
+        failures += checkOptimizer(corpus, lengths);
+
+        std::string scratch = "/tmp/n_puzzle_test." + std::to_string(getpid());
+
+        failures += checkLargeBoard();
+        failures += checkPerimeter(corpus, lengths);
+        failures += checkPatternDatabase(scratch + ".pdb");
+        failures += checkCheckpoint(corpus, lengths, scratch + ".checkpoint");
+        failures += checkCache(corpus, scratch + ".cache");
+        failures += checkPipeline(corpus, lengths);
+        failures += checkDaemon(corpus, lengths, scratch + ".sock");
+
+        return failures > 0 ? 1 : 0;
+    }
+    catch (const char* message) {
+        std::cout.flush();
+        fprintf(stderr, "%s\n", message);
+        return 1;
+    }
+}
@@ -0,0 +1,123 @@
+#ifndef N_PUZZLE_VERIFY_H
+#define N_PUZZLE_VERIFY_H
+
+#include "tables.h"
+#include "options.h"
+
+#include <unordered_set>
+
+// Checks the heuristic against exact distances found by a breadth-first
+// search back from the goal, over every state within radius moves of it:
+// admissibility (h never above the distance), consistency (h changes by at
+// most one per move) and that the incremental update of makeStep agrees with
+// recomputing from scratch. Returns the number of violations.
+inline long long verifyHeuristic(int side, int pos0, int radius, const PatternDatabase* pdb) {
+    std::vector<Puzzle> layer(1, goalPuzzle(side, pos0));
+    std::unordered_set<unsigned long long> seen;
+    seen.insert(layer[0].hashValue());
+
+    int cells = side * side;
+    std::vector<int> board(cells);
+    long long states = 0, violations = 0;
+    long long totalDistance = 0, totalManhattan = 0, totalHeuristic = 0;
+    int depth = 0;
+
+    auto report = [&](const char* what, Puzzle& p, int value) {
+        if (violations++ < 5) {
+            std::cout << what << " at distance " << depth << " (value " << value << "):" << '\n';
+            p.print();
+        }
+    };
+
+    for (; !layer.empty() && depth <= radius; depth++) {
+        std::vector<Puzzle> next;
+
+        for (Puzzle& node : layer) {
+            for (int cell = 0; cell < cells; cell++) {
+                board[cell] = node.at(cell / side, cell % side);
+            }
+
+            Puzzle fresh(board, side, pos0);
+            int h = node.estimate();
+            int md = fresh.manhattan();
+
+            if (!fresh.isSolvable()) {
+                report("Reachable board reported unsolvable", node, 0);
+            }
+            if (h != fresh.estimate()) {
+                report("Incremental heuristic differs", node, h);
+            }
+            if (md > depth) {
+                report("Manhattan distance not admissible", node, md);
+            }
+            if (pdb && pdb->covers(node) && pdb->distance(node) > depth) {
+                report("Pattern database not admissible", node, pdb->distance(node));
+            }
+            if (h > depth) {
+                report("Linear conflict not admissible", node, h);
+            }
+
+            for (Step s : steps) {
+                if (!node.canStep(s)) {
+                    continue;
+                }
+
+                Puzzle child = node.child(s);
+
+                if (abs(child.estimate() - h) > 1) {
+                    report("Linear conflict not consistent", node, child.estimate());
+                }
+                if (abs(child.manhattan() - md) > 1) {
+                    report("Manhattan distance not consistent", node, child.manhattan());
+                }
+                if (pdb && pdb->covers(node) && abs(pdb->distance(child) - pdb->distance(node)) > 1) {
+                    report("Pattern database not consistent", node, pdb->distance(child));
+                }
+
+                if (depth < radius && seen.insert(child.hashValue()).second) {
+                    next.push_back(child);
+                }
+            }
+
+            states++;
+            totalDistance += depth;
+            totalManhattan += md;
+            totalHeuristic += h;
+        }
+
+        layer.swap(next);
+    }
+
+    std::cout << side << "x" << side << " blank at " << pos0 << ": " << states << " states, max distance "
+              << depth - 1 << ", manhattan " << (double) totalManhattan / std::max(1LL, totalDistance)
+              << " and linear conflict " << (double) totalHeuristic / std::max(1LL, totalDistance)
+              << " of the exact distance, " << violations << " violations" << std::endl;
+
+    return violations;
+}
+
+// Verification mode: every 3x3 state for every blank position, and the 4x4
+// states within the perimeter radius (default 14) for the blank in a corner
+// and at the end. A pattern database given with --pdb is checked as well on
+// the boards it was built for.
+inline long long verifyHeuristics(const Options& options) {
+    long long violations = 0;
+    int radius = options.perimeter > 0 ? options.perimeter : 14;
+    std::unique_ptr<PatternDatabase> pdb;
+
+    if (!options.pdb.empty()) {
+        pdb.reset(new PatternDatabase(options.pdb));
+        fprintf(stderr, "Pattern database: %zu kB pages\n", pdb->getPageSize() >> 10);
+    }
+
+    for (int pos0 = 0; pos0 < 9; pos0++) {
+        violations += verifyHeuristic(3, pos0, INT_MAX, pdb.get());
+    }
+
+    violations += verifyHeuristic(4, 15, radius, pdb.get());
+    violations += verifyHeuristic(4, 0, radius, pdb.get());
+
+    return violations;
+}
+
+#endif